@@ -0,0 +1,401 @@
+#include "auto_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/statfs.h>
+#elif defined(__APPLE__)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
+
+namespace zero_copy {
+
+namespace {
+
+// 大小档位的上界（不含），最后一档没有上界
+const uint64_t kSizeBucketLimits[] = {64ull << 10, 1ull << 20, 16ull << 20, 256ull << 20};
+const char kTableHeader[] = "# zero_copy copy calibration v1";
+
+const AutoCopyMethod kCandidates[] = {
+    AutoCopyMethod::Traditional,
+    AutoCopyMethod::Mmap,
+#if defined(__linux__) || defined(__APPLE__)
+    AutoCopyMethod::Sendfile,
+#endif
+#ifdef __linux__
+    AutoCopyMethod::Splice,
+    AutoCopyMethod::CopyFileRange,
+#endif
+};
+
+struct CalibrationKey {
+    uint64_t src_fs_type = 0;
+    uint64_t dst_fs_type = 0;
+    bool same_device = false;
+    unsigned size_bucket = 0;
+
+    bool operator<(const CalibrationKey& other) const {
+        return std::tie(src_fs_type, dst_fs_type, same_device, size_bucket) <
+               std::tie(other.src_fs_type, other.dst_fs_type, other.same_device, other.size_bucket);
+    }
+};
+
+struct CalibrationEntry {
+    AutoCopyMethod method = AutoCopyMethod::Traditional;
+    double mb_per_s = 0;
+};
+
+typedef std::map<CalibrationKey, CalibrationEntry> CalibrationMap;
+
+// 进程内的校准表缓存，按表文件路径分别保存
+struct CalibrationCache {
+    std::mutex mutex;
+    std::map<std::string, CalibrationMap> tables;
+};
+
+CalibrationCache& calibration_cache() {
+    static CalibrationCache cache;
+    return cache;
+}
+
+unsigned size_bucket(uint64_t size) {
+    unsigned bucket = 0;
+    for (uint64_t limit : kSizeBucketLimits) {
+        if (size < limit) {
+            break;
+        }
+        ++bucket;
+    }
+    return bucket;
+}
+
+bool parse_method(const std::string& name, AutoCopyMethod& method) {
+    for (AutoCopyMethod candidate : kCandidates) {
+        if (name == auto_copy_method_name(candidate)) {
+            method = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool run_method(AutoCopyMethod method, const std::string& src_path, const std::string& dst_path) {
+    switch (method) {
+    case AutoCopyMethod::Traditional:
+        return traditional_copy(src_path, dst_path, 128 * 1024);
+    case AutoCopyMethod::Mmap:
+        return mmap_copy(src_path, dst_path);
+    case AutoCopyMethod::Sendfile:
+        return sendfile_copy(src_path, dst_path);
+    case AutoCopyMethod::Splice:
+        return splice_copy(src_path, dst_path);
+    case AutoCopyMethod::CopyFileRange:
+        return copy_file_range_copy(src_path, dst_path);
+    }
+    return false;
+}
+
+std::string parent_directory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string default_table_path() {
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home) {
+        return std::string(cache_home) + "/zero_copy/copy_calibration";
+    }
+    const char* home = getenv("HOME");
+    if (home && *home) {
+        return std::string(home) + "/.cache/zero_copy/copy_calibration";
+    }
+    return "";
+}
+
+// 文件系统类型（statfs的f_type）和所在设备
+bool filesystem_of(const std::string& path, uint64_t& fs_type, dev_t& device) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1) {
+        std::cerr << "Error reading " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    device = st.st_dev;
+    fs_type = 0;
+#if defined(__linux__) || defined(__APPLE__)
+    struct statfs fs;
+    if (statfs(path.c_str(), &fs) == 0) {
+        fs_type = static_cast<uint64_t>(fs.f_type);
+    }
+#endif
+    return true;
+}
+
+CalibrationMap load_table(const std::string& path) {
+    CalibrationMap table;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        // 每行：源文件系统 目标文件系统 是否同一设备 大小档位 方法 MB/s
+        std::istringstream fields(line);
+        CalibrationKey key;
+        std::string method_name;
+        CalibrationEntry entry;
+        if (fields >> std::hex >> key.src_fs_type >> key.dst_fs_type >> std::dec >> key.same_device
+                   >> key.size_bucket >> method_name >> entry.mb_per_s &&
+            parse_method(method_name, entry.method)) {
+            table[key] = entry;
+        }
+    }
+    return table;
+}
+
+void create_parent_directories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+}
+
+// 先写临时文件再rename，并发的进程不会读到写了一半的表
+bool save_table(const std::string& path, const CalibrationMap& table) {
+    create_parent_directories(path);
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp_path);
+        if (!out) {
+            return false;
+        }
+        out << kTableHeader << "\n";
+        for (const auto& item : table) {
+            out << std::hex << item.first.src_fs_type << " " << item.first.dst_fs_type << std::dec << " "
+                << item.first.same_device << " " << item.first.size_bucket << " "
+                << auto_copy_method_name(item.second.method) << " " << item.second.mb_per_s << "\n";
+        }
+        if (!out.flush()) {
+            unlink(tmp_path.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) == -1) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string make_temp_file(const std::string& dir, const char* name) {
+    std::string pattern = dir + "/" + name + ".XXXXXX";
+    std::vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    int fd = mkstemp(path.data());
+    if (fd == -1) {
+        std::cerr << "Error creating temporary file in " << dir << ": " << strerror(errno) << std::endl;
+        return "";
+    }
+    close(fd);
+    return path.data();
+}
+
+// 把源文件的前length字节写入sample_path
+bool write_sample(const std::string& src_path, const std::string& sample_path, uint64_t length) {
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int dst_fd = open(sample_path.c_str(), O_WRONLY | O_TRUNC);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening sample file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    bool ok = true;
+    uint64_t copied = 0;
+    while (ok && copied < length) {
+        ssize_t n = read(src_fd, buffer.data(), static_cast<size_t>(std::min<uint64_t>(buffer.size(), length - copied)));
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = write(dst_fd, buffer.data(), n) == n;
+        copied += n;
+    }
+    if (!ok) {
+        std::cerr << "Error writing sample file: " << strerror(errno) << std::endl;
+    }
+    close(src_fd);
+    close(dst_fd);
+    return ok;
+}
+
+// 在目标目录中给每种方法计时，返回中位数耗时最短的方法
+bool calibrate(const std::string& src_path, uint64_t size, const std::string& dst_dir,
+               const AutoCopyOptions& options, CalibrationEntry& best) {
+    std::string sample_path = src_path;
+    uint64_t sample_size = size;
+    if (size > options.max_sample_size) {
+        sample_path = make_temp_file(dst_dir, ".zero_copy_sample");
+        sample_size = options.max_sample_size;
+        if (sample_path.empty()) {
+            return false;
+        }
+        if (!write_sample(src_path, sample_path, sample_size)) {
+            unlink(sample_path.c_str());
+            return false;
+        }
+    }
+    std::string output_path = make_temp_file(dst_dir, ".zero_copy_calibration");
+    if (output_path.empty()) {
+        if (sample_path != src_path) {
+            unlink(sample_path.c_str());
+        }
+        return false;
+    }
+
+    // 各方法轮流计时，页缓存状态对所有方法的影响大致相同
+    const size_t count = sizeof(kCandidates) / sizeof(kCandidates[0]);
+    std::vector<std::vector<double>> samples(count);
+    std::vector<bool> failed(count, false);
+    unsigned rounds = std::max(1u, options.rounds);
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < count; ++i) {
+            if (failed[i]) {
+                continue;
+            }
+            bool ok = false;
+            auto elapsed = measure_time([&]() { ok = run_method(kCandidates[i], sample_path, output_path); });
+            if (!ok) {
+                failed[i] = true;
+                continue;
+            }
+            samples[i].push_back(static_cast<double>(std::max<int64_t>(elapsed.count(), 1)));
+        }
+    }
+
+    unlink(output_path.c_str());
+    if (sample_path != src_path) {
+        unlink(sample_path.c_str());
+    }
+
+    double best_us = 0;
+    bool found = false;
+    for (size_t i = 0; i < count; ++i) {
+        if (failed[i] || samples[i].empty()) {
+            continue;
+        }
+        std::sort(samples[i].begin(), samples[i].end());
+        double median_us = samples[i][samples[i].size() / 2];
+        if (!found || median_us < best_us) {
+            found = true;
+            best_us = median_us;
+            best.method = kCandidates[i];
+            best.mb_per_s = (sample_size / (1024.0 * 1024.0)) / (median_us / 1e6);
+        }
+    }
+    if (!found) {
+        std::cerr << "Error: no copy method succeeded during calibration" << std::endl;
+    }
+    return found;
+}
+
+} // namespace
+
+const char* auto_copy_method_name(AutoCopyMethod method) {
+    switch (method) {
+    case AutoCopyMethod::Traditional:
+        return "traditional";
+    case AutoCopyMethod::Mmap:
+        return "mmap";
+    case AutoCopyMethod::Sendfile:
+        return "sendfile";
+    case AutoCopyMethod::Splice:
+        return "splice";
+    case AutoCopyMethod::CopyFileRange:
+        return "copy_file_range";
+    }
+    return "unknown";
+}
+
+bool auto_copy(const std::string& src_path, const std::string& dst_path,
+               const AutoCopyOptions& options, AutoCopyResult* result) {
+    struct stat st;
+    if (stat(src_path.c_str(), &st) == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    std::string dst_dir = parent_directory(dst_path);
+
+    CalibrationKey key;
+    dev_t src_device = 0;
+    dev_t dst_device = 0;
+    if (!filesystem_of(src_path, key.src_fs_type, src_device) ||
+        !filesystem_of(dst_dir, key.dst_fs_type, dst_device)) {
+        return false;
+    }
+    key.same_device = src_device == dst_device;
+    key.size_bucket = size_bucket(size);
+
+    std::string table_path = options.table_path.empty() ? default_table_path() : options.table_path;
+    CalibrationEntry entry;
+    bool calibrated = false;
+    {
+        // 校准期间持有锁，同一进程中的并发调用不会重复校准
+        CalibrationCache& cache = calibration_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto loaded = cache.tables.find(table_path);
+        if (loaded == cache.tables.end()) {
+            loaded = cache.tables.emplace(table_path, table_path.empty() ? CalibrationMap() : load_table(table_path)).first;
+        }
+        CalibrationMap& table = loaded->second;
+        auto found = table.find(key);
+        if (found != table.end() && !options.recalibrate) {
+            entry = found->second;
+        } else {
+            if (!calibrate(src_path, size, dst_dir, options, entry)) {
+                return false;
+            }
+            calibrated = true;
+            if (!table_path.empty()) {
+                // 重新读取表文件，保留其他进程在此期间写入的结果
+                CalibrationMap latest = load_table(table_path);
+                latest.insert(table.begin(), table.end());
+                table.swap(latest);
+            }
+            table[key] = entry;
+            if (!table_path.empty() && !save_table(table_path, table)) {
+                std::cerr << "Warning: could not save calibration table " << table_path << std::endl;
+            }
+        }
+    }
+
+    if (result) {
+        result->method = entry.method;
+        result->calibrated = calibrated;
+        result->mb_per_s = entry.mb_per_s;
+    }
+    return run_method(entry.method, src_path, dst_path);
+}
+
+} // namespace zero_copy
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// auto_copy可以选择的复制方法
+enum class AutoCopyMethod {
+    Traditional,
+    Mmap,
+    Sendfile,
+    Splice,
+    CopyFileRange
+};
+
+const char* auto_copy_method_name(AutoCopyMethod method);
+
+struct AutoCopyOptions {
+    // 校准表的路径，为空时使用$XDG_CACHE_HOME/zero_copy/copy_calibration
+    // （没有XDG_CACHE_HOME时为~/.cache/zero_copy/copy_calibration）
+    std::string table_path;
+    unsigned rounds = 3;                            // 每种方法的计时次数，取中位数
+    uint64_t max_sample_size = 64ull << 20;         // 校准样本的最大字节数
+    bool recalibrate = false;                       // 忽略已有结果，重新校准当前的组合
+};
+
+struct AutoCopyResult {
+    AutoCopyMethod method = AutoCopyMethod::Traditional;
+    bool calibrated = false;        // 本次调用是否进行了校准（false表示使用了校准表中的结果）
+    double mb_per_s = 0;            // 校准时该方法的吞吐量
+};
+
+// 自动选择最快的复制方法
+// 校准表以（源文件系统类型、目标文件系统类型、是否同一设备、大小档位）为键，
+// 大小档位的分界为64KB、1MB、16MB和256MB。某个键第一次出现时，
+// 用不超过max_sample_size字节的样本在目标目录中把每种方法计时rounds次，
+// 把最快的方法写入校准表；以后的调用直接使用表中的方法。
+// 校准表无法写入时结果只保存在进程内。
+bool auto_copy(const std::string& src_path, const std::string& dst_path,
+               const AutoCopyOptions& options = AutoCopyOptions(), AutoCopyResult* result = nullptr);
+
+} // namespace zero_copy
@@ -0,0 +1,95 @@
+#include "checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define ZERO_COPY_HAVE_SSE42_CRC 1
+#endif
+
+namespace zero_copy {
+
+namespace {
+
+// 反射形式的Castagnoli多项式
+const uint32_t kCrc32cPoly = 0x82F63B78u;
+
+struct Crc32cTable {
+    uint32_t entries[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (kCrc32cPoly & (0u - (crc & 1u)));
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+uint32_t crc32c_software(uint32_t crc, const unsigned char* data, size_t length) {
+    static const Crc32cTable table;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef ZERO_COPY_HAVE_SSE42_CRC
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(uint32_t crc, const unsigned char* data, size_t length) {
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (length >= 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+        ++data;
+        --length;
+    }
+    return crc;
+}
+
+bool cpu_has_sse42() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+} // namespace
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#ifdef ZERO_COPY_HAVE_SSE42_CRC
+    if (cpu_has_sse42()) {
+        return ~crc32c_sse42(crc, bytes, length);
+    }
+#endif
+    return ~crc32c_software(crc, bytes, length);
+}
+
+bool crc32c_hardware_accelerated() {
+#ifdef ZERO_COPY_HAVE_SSE42_CRC
+    return cpu_has_sse42();
+#else
+    return false;
+#endif
+}
+
+} // namespace zero_copy
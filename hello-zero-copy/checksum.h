@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 增量计算CRC32C（Castagnoli多项式）
+// 第一次调用时crc传入0，之后把上一次的返回值传入即可继续计算后续数据。
+// x86上运行时检测SSE4.2并使用crc32指令，否则使用查表实现。
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+// 当前是否使用了硬件加速的实现
+bool crc32c_hardware_accelerated();
+
+} // namespace zero_copy
@@ -0,0 +1,628 @@
+#include "compressed_copy.h"
+#include "checksum.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef ZERO_COPY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef ZERO_COPY_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace zero_copy {
+
+const char* compression_codec_name(CompressionCodec codec) {
+    switch (codec) {
+    case CompressionCodec::Stored:
+        return "stored";
+    case CompressionCodec::Zstd:
+        return "zstd";
+    case CompressionCodec::Lz4:
+        return "lz4";
+    }
+    return "unknown";
+}
+
+CompressionCodec default_compression_codec() {
+#if defined(ZERO_COPY_HAVE_ZSTD)
+    return CompressionCodec::Zstd;
+#elif defined(ZERO_COPY_HAVE_LZ4)
+    return CompressionCodec::Lz4;
+#else
+    return CompressionCodec::Stored;
+#endif
+}
+
+bool compression_codec_available(CompressionCodec codec) {
+    switch (codec) {
+    case CompressionCodec::Stored:
+        return true;
+    case CompressionCodec::Zstd:
+#ifdef ZERO_COPY_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case CompressionCodec::Lz4:
+#ifdef ZERO_COPY_HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+namespace {
+
+// 文件格式（所有整数均为小端序）：
+//   文件头：magic(8) version(4) codec(4) chunk_size(8) original_size(8)
+//   索引项：offset(8) compressed_size(4) original_size(4) crc32c(4) flags(4)
+//   文件尾：index_offset(8) chunk_count(8) magic(8)
+const char kHeaderMagic[8] = {'Z', 'C', 'C', 'H', 'U', 'N', 'K', '1'};
+const char kFooterMagic[8] = {'Z', 'C', 'I', 'N', 'D', 'E', 'X', '1'};
+const uint32_t kFormatVersion = 1;
+const size_t kHeaderSize = 32;
+const size_t kIndexEntrySize = 24;
+const size_t kFooterSize = 24;
+// 块的数据没有压缩，原样存储
+const uint32_t kChunkStored = 1;
+// 块大小以32位保存，并且不能超过lz4的输入上限
+const size_t kMaxChunkSize = 256 * 1024 * 1024;
+
+void put_u32(unsigned char* p, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void put_u64(unsigned char* p, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t get_u32(const unsigned char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t get_u64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+struct ChunkEntry {
+    uint64_t offset = 0;
+    uint32_t compressed_size = 0;
+    uint32_t original_size = 0;
+    uint32_t crc = 0;
+    uint32_t flags = 0;
+};
+
+// 读满length字节，返回false表示出错或提前到达文件末尾
+bool read_exact(int fd, void* buffer, size_t length, off_t offset) {
+    char* p = static_cast<char*>(buffer);
+    while (length > 0) {
+        ssize_t n = pread(fd, p, length, offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+        p += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool write_exact(int fd, const void* buffer, size_t length, off_t offset) {
+    const char* p = static_cast<const char*>(buffer);
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// 每个工作线程持有自己的压缩/解压上下文，避免每块重新分配
+class ChunkCodec {
+public:
+    ChunkCodec(CompressionCodec codec, int level) : codec_(codec), level_(level) {}
+    ~ChunkCodec() {
+#ifdef ZERO_COPY_HAVE_ZSTD
+        ZSTD_freeCCtx(cctx_);
+        ZSTD_freeDCtx(dctx_);
+#endif
+    }
+    ChunkCodec(const ChunkCodec&) = delete;
+    ChunkCodec& operator=(const ChunkCodec&) = delete;
+
+    // 压缩输出缓冲区需要的最大大小
+    size_t bound(size_t length) const {
+        switch (codec_) {
+#ifdef ZERO_COPY_HAVE_ZSTD
+        case CompressionCodec::Zstd:
+            return ZSTD_compressBound(length);
+#endif
+#ifdef ZERO_COPY_HAVE_LZ4
+        case CompressionCodec::Lz4:
+            return static_cast<size_t>(LZ4_compressBound(static_cast<int>(length)));
+#endif
+        default:
+            return length;
+        }
+    }
+
+    // 返回压缩后的大小；出错或压缩后没有变小时返回0，由调用方原样存储
+    size_t compress(const char* src, size_t length, char* dst, size_t capacity) {
+        switch (codec_) {
+#ifdef ZERO_COPY_HAVE_ZSTD
+        case CompressionCodec::Zstd: {
+            if (!cctx_ && !(cctx_ = ZSTD_createCCtx())) {
+                return 0;
+            }
+            size_t result = ZSTD_compressCCtx(cctx_, dst, capacity, src, length, level_);
+            return ZSTD_isError(result) || result >= length ? 0 : result;
+        }
+#endif
+#ifdef ZERO_COPY_HAVE_LZ4
+        case CompressionCodec::Lz4: {
+            int result = LZ4_compress_default(src, dst, static_cast<int>(length), static_cast<int>(capacity));
+            return result <= 0 || static_cast<size_t>(result) >= length ? 0 : static_cast<size_t>(result);
+        }
+#endif
+        default:
+            (void)src;
+            (void)length;
+            (void)dst;
+            (void)capacity;
+            (void)level_;
+            return 0;
+        }
+    }
+
+    // 解压后的大小必须正好是original
+    bool decompress(const char* src, size_t length, char* dst, size_t original) {
+        switch (codec_) {
+#ifdef ZERO_COPY_HAVE_ZSTD
+        case CompressionCodec::Zstd: {
+            if (!dctx_ && !(dctx_ = ZSTD_createDCtx())) {
+                return false;
+            }
+            size_t result = ZSTD_decompressDCtx(dctx_, dst, original, src, length);
+            return !ZSTD_isError(result) && result == original;
+        }
+#endif
+#ifdef ZERO_COPY_HAVE_LZ4
+        case CompressionCodec::Lz4:
+            return LZ4_decompress_safe(src, dst, static_cast<int>(length), static_cast<int>(original)) ==
+                   static_cast<int>(original);
+#endif
+        default:
+            (void)src;
+            (void)length;
+            (void)dst;
+            (void)original;
+            return false;
+        }
+    }
+
+private:
+    CompressionCodec codec_;
+    int level_;
+#ifdef ZERO_COPY_HAVE_ZSTD
+    ZSTD_CCtx* cctx_ = nullptr;
+    ZSTD_DCtx* dctx_ = nullptr;
+#endif
+};
+
+// 压缩和解压的工作线程共享的状态
+struct ChunkPipelineState {
+    int src_fd = -1;
+    int dst_fd = -1;
+    CompressionCodec codec = CompressionCodec::Stored;
+    int level = 0;
+    size_t chunk_size = 0;
+    uint64_t original_size = 0;
+    std::vector<ChunkEntry> index;
+    size_t max_compressed_size = 0;     // 解压时最大的压缩块，用于分配读缓冲区
+    std::atomic<uint64_t> next_chunk{0};
+    std::atomic<uint64_t> stored_chunks{0};
+    std::atomic<bool> abort{false};
+
+    // 压缩块必须按顺序排列：块i等到前面的块都分配了输出位置后，再为自己分配位置
+    std::mutex mutex;
+    std::condition_variable turn;
+    uint64_t next_to_place = 0;
+    uint64_t write_offset = kHeaderSize;
+    std::string error;
+
+    // 记录第一个错误并唤醒所有等待的线程
+    void fail(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error.empty()) {
+                error = message;
+            }
+            abort.store(true, std::memory_order_relaxed);
+        }
+        turn.notify_all();
+    }
+};
+
+void compress_worker(ChunkPipelineState& state) {
+    ChunkCodec codec(state.codec, state.level);
+    std::vector<char> input(state.chunk_size);
+    std::vector<char> output(codec.bound(state.chunk_size));
+    uint64_t chunk_count = state.index.size();
+
+    while (!state.abort.load(std::memory_order_relaxed)) {
+        uint64_t chunk = state.next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunk_count) {
+            break;
+        }
+        off_t offset = static_cast<off_t>(chunk * state.chunk_size);
+        size_t length = static_cast<size_t>(std::min<uint64_t>(state.chunk_size, state.original_size - offset));
+        if (!read_exact(state.src_fd, input.data(), length, offset)) {
+            state.fail(std::string("Error reading from source file: ") + strerror(errno));
+            return;
+        }
+
+        ChunkEntry entry;
+        entry.original_size = static_cast<uint32_t>(length);
+        entry.crc = crc32c(0, input.data(), length);
+        size_t compressed = codec.compress(input.data(), length, output.data(), output.size());
+        const char* payload = output.data();
+        if (compressed == 0) {
+            payload = input.data();
+            compressed = length;
+            entry.flags |= kChunkStored;
+            state.stored_chunks.fetch_add(1, std::memory_order_relaxed);
+        }
+        entry.compressed_size = static_cast<uint32_t>(compressed);
+
+        // 只在分配输出位置时串行，写入本身可以和其他块并行
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.turn.wait(lock, [&]() {
+                return state.abort.load(std::memory_order_relaxed) || state.next_to_place == chunk;
+            });
+            if (state.abort.load(std::memory_order_relaxed)) {
+                return;
+            }
+            entry.offset = state.write_offset;
+            state.write_offset += compressed;
+            state.index[chunk] = entry;
+            ++state.next_to_place;
+        }
+        state.turn.notify_all();
+
+        if (!write_exact(state.dst_fd, payload, compressed, static_cast<off_t>(entry.offset))) {
+            state.fail(std::string("Error writing to destination file: ") + strerror(errno));
+            return;
+        }
+    }
+}
+
+void decompress_worker(ChunkPipelineState& state) {
+    ChunkCodec codec(state.codec, 0);
+    std::vector<char> input(state.max_compressed_size);
+    std::vector<char> output(state.chunk_size);
+    uint64_t chunk_count = state.index.size();
+
+    while (!state.abort.load(std::memory_order_relaxed)) {
+        uint64_t chunk = state.next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunk_count) {
+            break;
+        }
+        const ChunkEntry& entry = state.index[chunk];
+        if (!read_exact(state.src_fd, input.data(), entry.compressed_size, static_cast<off_t>(entry.offset))) {
+            state.fail(std::string("Error reading compressed chunk: ") + strerror(errno));
+            return;
+        }
+
+        const char* data = input.data();
+        if (!(entry.flags & kChunkStored)) {
+            if (!codec.decompress(input.data(), entry.compressed_size, output.data(), entry.original_size)) {
+                state.fail("Error: failed to decompress chunk " + std::to_string(chunk));
+                return;
+            }
+            data = output.data();
+        }
+        if (crc32c(0, data, entry.original_size) != entry.crc) {
+            state.fail("Error: checksum mismatch in chunk " + std::to_string(chunk));
+            return;
+        }
+        off_t offset = static_cast<off_t>(chunk * state.chunk_size);
+        if (!write_exact(state.dst_fd, data, entry.original_size, offset)) {
+            state.fail(std::string("Error writing to destination file: ") + strerror(errno));
+            return;
+        }
+    }
+}
+
+// 启动threads个线程（包括当前线程）执行worker
+void run_workers(void (*worker)(ChunkPipelineState&), ChunkPipelineState& state, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threads, state.index.size())));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker, std::ref(state));
+        }
+    } catch (const std::system_error&) {
+        // 线程创建失败时由已有线程和当前线程完成剩余的块
+    }
+    worker(state);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
+
+} // namespace
+
+bool compress_copy(const std::string& src_path, const std::string& dst_path,
+                   const CompressionOptions& options, CompressionStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    if (!compression_codec_available(options.codec)) {
+        std::cerr << "Error: " << compression_codec_name(options.codec)
+                  << " support was not compiled in" << std::endl;
+        return false;
+    }
+    if (options.chunk_size == 0 || options.chunk_size > kMaxChunkSize) {
+        std::cerr << "Error: chunk size must be between 1 byte and 256 MB" << std::endl;
+        return false;
+    }
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        return false;
+    }
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    ChunkPipelineState state;
+    state.src_fd = src_fd;
+    state.dst_fd = dst_fd;
+    state.codec = options.codec;
+    state.level = options.level;
+    state.chunk_size = options.chunk_size;
+    state.original_size = static_cast<uint64_t>(src_size);
+    state.index.resize((state.original_size + options.chunk_size - 1) / options.chunk_size);
+
+    run_workers(compress_worker, state, options.threads);
+
+    bool success = !state.abort.load();
+    uint64_t index_offset = state.write_offset;
+    if (success) {
+        // 索引和文件尾放在所有块之后，文件头最后写入
+        std::vector<unsigned char> tail(state.index.size() * kIndexEntrySize + kFooterSize);
+        unsigned char* p = tail.data();
+        for (const auto& entry : state.index) {
+            put_u64(p, entry.offset);
+            put_u32(p + 8, entry.compressed_size);
+            put_u32(p + 12, entry.original_size);
+            put_u32(p + 16, entry.crc);
+            put_u32(p + 20, entry.flags);
+            p += kIndexEntrySize;
+        }
+        put_u64(p, index_offset);
+        put_u64(p + 8, state.index.size());
+        memcpy(p + 16, kFooterMagic, sizeof(kFooterMagic));
+
+        unsigned char header[kHeaderSize];
+        memcpy(header, kHeaderMagic, sizeof(kHeaderMagic));
+        put_u32(header + 8, kFormatVersion);
+        put_u32(header + 12, static_cast<uint32_t>(options.codec));
+        put_u64(header + 16, options.chunk_size);
+        put_u64(header + 24, state.original_size);
+
+        if (!write_exact(dst_fd, tail.data(), tail.size(), static_cast<off_t>(index_offset)) ||
+            !write_exact(dst_fd, header, sizeof(header), 0)) {
+            state.error = std::string("Error writing to destination file: ") + strerror(errno);
+            success = false;
+        }
+    }
+
+    close(src_fd);
+    if (close(dst_fd) == -1 && success) {
+        state.error = std::string("Error closing destination file: ") + strerror(errno);
+        success = false;
+    }
+    if (!success) {
+        std::cerr << state.error << std::endl;
+        unlink(dst_path.c_str());
+        return false;
+    }
+
+    if (stats) {
+        stats->original_bytes = state.original_size;
+        stats->compressed_bytes = index_offset + state.index.size() * kIndexEntrySize + kFooterSize;
+        stats->chunks = state.index.size();
+        stats->stored_chunks = state.stored_chunks.load();
+        stats->elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+    return true;
+}
+
+bool decompress_copy(const std::string& src_path, const std::string& dst_path,
+                     unsigned threads, CompressionStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        return false;
+    }
+
+    // 先读文件尾找到索引，再读文件头
+    unsigned char header[kHeaderSize];
+    unsigned char footer[kFooterSize];
+    if (static_cast<uint64_t>(src_size) < kHeaderSize + kFooterSize ||
+        !read_exact(src_fd, footer, kFooterSize, src_size - static_cast<off_t>(kFooterSize)) ||
+        !read_exact(src_fd, header, kHeaderSize, 0) ||
+        memcmp(footer + 16, kFooterMagic, sizeof(kFooterMagic)) != 0 ||
+        memcmp(header, kHeaderMagic, sizeof(kHeaderMagic)) != 0) {
+        std::cerr << "Error: " << src_path << " is not a chunked compressed file" << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    ChunkPipelineState state;
+    state.src_fd = src_fd;
+    uint32_t version = get_u32(header + 8);
+    state.codec = static_cast<CompressionCodec>(get_u32(header + 12));
+    state.chunk_size = static_cast<size_t>(get_u64(header + 16));
+    state.original_size = get_u64(header + 24);
+    uint64_t index_offset = get_u64(footer);
+    uint64_t chunk_count = get_u64(footer + 8);
+
+    // 文件头和文件尾中的数字都不可信，先用文件大小限制条目数，之后的乘法和加法才不会溢出
+    uint64_t max_entries = (static_cast<uint64_t>(src_size) - kHeaderSize - kFooterSize) / kIndexEntrySize;
+    std::string problem;
+    if (version != kFormatVersion) {
+        problem = "unsupported format version " + std::to_string(version);
+    } else if (!compression_codec_available(state.codec)) {
+        problem = std::string(compression_codec_name(state.codec)) + " support was not compiled in";
+    } else if (state.chunk_size == 0 || state.chunk_size > kMaxChunkSize ||
+               chunk_count > max_entries ||
+               chunk_count != state.original_size / state.chunk_size + (state.original_size % state.chunk_size != 0) ||
+               index_offset < kHeaderSize ||
+               index_offset != static_cast<uint64_t>(src_size) - kFooterSize - chunk_count * kIndexEntrySize) {
+        problem = "corrupt header or index";
+    }
+
+    std::vector<unsigned char> raw_index;
+    if (problem.empty()) {
+        raw_index.resize(chunk_count * kIndexEntrySize);
+        if (!read_exact(src_fd, raw_index.data(), raw_index.size(), static_cast<off_t>(index_offset))) {
+            problem = std::string("cannot read index: ") + strerror(errno);
+        }
+    }
+    if (problem.empty()) {
+        state.index.resize(chunk_count);
+        for (uint64_t i = 0; i < chunk_count && problem.empty(); ++i) {
+            const unsigned char* p = raw_index.data() + i * kIndexEntrySize;
+            ChunkEntry& entry = state.index[i];
+            entry.offset = get_u64(p);
+            entry.compressed_size = get_u32(p + 8);
+            entry.original_size = get_u32(p + 12);
+            entry.crc = get_u32(p + 16);
+            entry.flags = get_u32(p + 20);
+            uint64_t expected = std::min<uint64_t>(state.chunk_size, state.original_size - i * state.chunk_size);
+            bool stored = (entry.flags & kChunkStored) != 0;
+            if (entry.original_size != expected || entry.offset < kHeaderSize ||
+                entry.offset + entry.compressed_size > index_offset ||
+                (stored && entry.compressed_size != entry.original_size)) {
+                problem = "corrupt index entry " + std::to_string(i);
+            }
+            state.max_compressed_size = std::max<size_t>(state.max_compressed_size, entry.compressed_size);
+        }
+    }
+    if (!problem.empty()) {
+        std::cerr << "Error: " << problem << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+    state.dst_fd = dst_fd;
+    if (ftruncate(dst_fd, static_cast<off_t>(state.original_size)) == -1) {
+        std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
+        close(src_fd);
+        close(dst_fd);
+        unlink(dst_path.c_str());
+        return false;
+    }
+
+    run_workers(decompress_worker, state, threads);
+
+    bool success = !state.abort.load();
+    close(src_fd);
+    if (close(dst_fd) == -1 && success) {
+        state.error = std::string("Error closing destination file: ") + strerror(errno);
+        success = false;
+    }
+    if (!success) {
+        std::cerr << state.error << std::endl;
+        unlink(dst_path.c_str());
+        return false;
+    }
+
+    if (stats) {
+        stats->original_bytes = state.original_size;
+        stats->compressed_bytes = static_cast<uint64_t>(src_size);
+        stats->chunks = chunk_count;
+        stats->stored_chunks = 0;
+        for (const auto& entry : state.index) {
+            if (entry.flags & kChunkStored) {
+                ++stats->stored_chunks;
+            }
+        }
+        stats->elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+    return true;
+}
+
+} // namespace zero_copy
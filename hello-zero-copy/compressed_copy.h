@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 分块压缩使用的压缩算法，数值写入文件头
+enum class CompressionCodec : uint32_t {
+    Stored = 0,     // 不压缩，只按块存储
+    Zstd = 1,
+    Lz4 = 2
+};
+
+const char* compression_codec_name(CompressionCodec codec);
+
+// 构建时选择的压缩库（CMake选项ZERO_COPY_COMPRESSOR），都不可用时为Stored
+CompressionCodec default_compression_codec();
+
+// 当前构建是否能处理该算法
+bool compression_codec_available(CompressionCodec codec);
+
+struct CompressionOptions {
+    CompressionCodec codec = default_compression_codec();
+    int level = 3;                      // zstd的压缩级别；lz4忽略
+    size_t chunk_size = 4 * 1024 * 1024; // 每个独立压缩块的原始大小
+    unsigned threads = 0;               // 0表示使用硬件并发数
+};
+
+struct CompressionStats {
+    uint64_t original_bytes = 0;
+    uint64_t compressed_bytes = 0;      // 整个输出文件的大小，包括文件头和索引
+    uint64_t chunks = 0;
+    uint64_t stored_chunks = 0;         // 压缩后没有变小而原样存储的块数
+    std::chrono::microseconds elapsed{0};
+};
+
+// 把源文件切成独立的块，在线程池中并行压缩后写成可随机访问的分块格式：
+//   文件头 | 压缩块 ... | 块索引（每块的偏移、大小和CRC32C） | 文件尾（索引位置和块数）
+// 各块按原始顺序写入，解压时可以直接定位到任意一块。失败时删除不完整的目标文件。
+bool compress_copy(const std::string& src_path, const std::string& dst_path,
+                   const CompressionOptions& options = CompressionOptions(),
+                   CompressionStats* stats = nullptr);
+
+// 并行解压compress_copy生成的文件，每个块解压后校验CRC32C并写到原始位置
+bool decompress_copy(const std::string& src_path, const std::string& dst_path,
+                     unsigned threads = 0, CompressionStats* stats = nullptr);
+
+} // namespace zero_copy
@@ -0,0 +1,541 @@
+#include "copy_benchmark.h"
+#include "zero_copy_examples.h"
+#include "parallel_copy.h"
+#include "direct_io_copy.h"
+#include "sparse_copy.h"
+#include "verified_copy.h"
+#include "splice_engine.h"
+#include "paced_copy.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+std::vector<CopyMethod> default_copy_methods() {
+    std::vector<CopyMethod> methods;
+    methods.push_back({"traditional", ".traditional",
+                       [](const std::string& src, const std::string& dst, size_t buffer_size) {
+                           return traditional_copy(src, dst, buffer_size);
+                       }, SweepParameter::BufferSize});
+    methods.back().default_buffer_size = 4096;
+    methods.push_back({"mmap", ".mmap",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return mmap_copy(src, dst);
+                       }, SweepParameter::None, false});
+    // 普通memcpy的mmap复制，用于对比非临时存储对吞吐量和LLC miss的影响
+    methods.push_back({"mmap_memcpy", ".mmap_memcpy",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return mmap_copy(src, dst, false);
+                       }, SweepParameter::None, false});
+    methods.push_back({"mmap_window", ".mmap_window",
+                       [](const std::string& src, const std::string& dst, size_t window_size) {
+                           MmapWindowOptions options;
+                           options.window_size = window_size;
+                           return mmap_window_copy(src, dst, options);
+                       }, SweepParameter::WindowSize, false});
+    methods.push_back({"paced", ".paced",
+                       [](const std::string& src, const std::string& dst, size_t buffer_size) {
+                           PacedCopyOptions options;
+                           options.chunk_size = buffer_size;
+                           return paced_copy(src, dst, options);
+                       }, SweepParameter::BufferSize});
+    methods.back().default_buffer_size = PacedCopyOptions().chunk_size;
+#if defined(__linux__) || defined(__APPLE__)
+    methods.push_back({"sendfile", ".sendfile",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return sendfile_copy(src, dst);
+                       }, SweepParameter::None});
+#endif
+#ifdef __linux__
+    methods.push_back({"splice", ".splice",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return splice_copy(src, dst);
+                       }, SweepParameter::None, false});
+    // 旧的splice实现：每次复制新建默认64KB的管道，用于对比管道池和扩大管道的效果
+    methods.push_back({"splice_unpooled", ".splice_unpooled",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           SpliceEngineOptions options;
+                           options.pipe_size = 64 * 1024;
+                           options.reuse_pipes = false;
+                           return SpliceEngine(options).copy(src, dst);
+                       }, SweepParameter::None, false});
+    methods.push_back({"copy_file_range", ".copy_file_range",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return copy_file_range_copy(src, dst);
+                       }, SweepParameter::None});
+    methods.push_back({"io_uring", ".io_uring",
+                       [](const std::string& src, const std::string& dst, size_t buffer_size) {
+                           return io_uring_copy(src, dst, 32, buffer_size);
+                       }, SweepParameter::BufferSize, false});
+    methods.back().default_buffer_size = 128 * 1024;
+#endif
+    methods.push_back({"direct_io", ".direct_io",
+                       [](const std::string& src, const std::string& dst, size_t buffer_size) {
+                           return direct_io_copy(src, dst, buffer_size);
+                       }, SweepParameter::BufferSize});
+    methods.back().default_buffer_size = 1024 * 1024;
+    // 每个O_DIRECT块都是一次同步的设备I/O，4KB的块测出的只是设备的IOPS上限
+    methods.back().min_buffer_size = 1024 * 1024;
+    methods.push_back({"sparse", ".sparse",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return sparse_copy(src, dst);
+                       }, SweepParameter::None});
+    for (auto verified : {VerifiedCopyMethod::Buffered, VerifiedCopyMethod::Mmap, VerifiedCopyMethod::Splice}) {
+        std::string name = std::string("verified_") + verified_copy_method_name(verified);
+        methods.push_back({name, "." + name,
+                           [verified](const std::string& src, const std::string& dst, size_t) {
+                               return verified_copy(src, dst, verified);
+                           }, SweepParameter::None, verified == VerifiedCopyMethod::Buffered});
+    }
+    methods.push_back({"parallel", ".parallel",
+                       [](const std::string& src, const std::string& dst, size_t) {
+                           return parallel_copy(src, dst);
+                       }, SweepParameter::None});
+    return methods;
+}
+
+bool evict_page_cache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    // DONTNEED只会丢弃干净页，所以要先把脏页写回
+    bool ok = fsync(fd) == 0;
+#if defined(POSIX_FADV_DONTNEED)
+    ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0 && ok;
+#endif
+    close(fd);
+    return ok;
+}
+
+bool reset_peak_rss() {
+#ifdef __linux__
+    // 写入5会把VmHWM重置为当前RSS（Linux 4.0+）
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+long read_peak_rss_kb() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+#endif
+    return -1;
+}
+
+namespace {
+
+// 最近秩法计算百分位数，sorted必须已排序且非空
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+double total_bytes(const BenchmarkResult& result) {
+    return static_cast<double>(result.file_size) * result.file_count;
+}
+
+void compute_statistics(BenchmarkResult& result) {
+    if (result.samples_us.empty()) {
+        result.ok = false;
+        return;
+    }
+    std::vector<double> sorted = result.samples_us;
+    std::sort(sorted.begin(), sorted.end());
+    result.min_us = sorted.front();
+    result.median_us = sorted.size() % 2 == 1
+        ? sorted[sorted.size() / 2]
+        : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2.0;
+    result.p95_us = percentile(sorted, 95.0);
+    result.mean_us = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    if (result.median_us > 0) {
+        result.mb_per_s = (total_bytes(result) / (1024.0 * 1024.0)) / (result.median_us / 1e6);
+    }
+}
+
+std::string format_size(uint64_t bytes) {
+    const char* units[] = {"B", "K", "M", "G", "T"};
+    int unit = 0;
+    while (bytes >= 1024 && bytes % 1024 == 0 && unit < 4) {
+        bytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(bytes) + units[unit];
+}
+
+// 多文件时显示为"4Kx1000"
+std::string format_workload(const BenchmarkResult& result) {
+    std::string text = format_size(result.file_size);
+    if (result.file_count > 1) {
+        text += "x" + std::to_string(result.file_count);
+    }
+    return text;
+}
+
+std::string destination_path(const std::string& dst_prefix, size_t index, size_t count, const std::string& suffix) {
+    return count > 1 ? dst_prefix + "." + std::to_string(index) + suffix : dst_prefix + suffix;
+}
+
+std::string kernel_version() {
+    struct utsname info;
+    if (uname(&info) == -1) {
+        return "unknown";
+    }
+    return std::string(info.sysname) + " " + info.release;
+}
+
+std::string json_escape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+std::vector<BenchmarkResult> benchmark_file(const std::string& src_path, const std::string& dst_prefix,
+                                            const BenchmarkOptions& options) {
+    return benchmark_files({src_path}, dst_prefix, options);
+}
+
+std::vector<BenchmarkResult> benchmark_files(const std::vector<std::string>& src_paths, const std::string& dst_prefix,
+                                             const BenchmarkOptions& options) {
+    std::vector<BenchmarkResult> results;
+    if (src_paths.empty()) {
+        return results;
+    }
+
+    // 多文件时按第一个文件的大小报告，生成的文件大小都相同
+    int src_fd = open(src_paths.front().c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return results;
+    }
+    off_t file_size = get_file_size(src_fd);
+    close(src_fd);
+    if (file_size == -1) {
+        return results;
+    }
+
+    for (const auto& method : default_copy_methods()) {
+        if (!options.methods.empty() &&
+            std::find(options.methods.begin(), options.methods.end(), method.name) == options.methods.end()) {
+            continue;
+        }
+
+        std::vector<size_t> buffer_sizes = {0};
+        if (method.sweep == SweepParameter::BufferSize) {
+            buffer_sizes = options.buffer_sizes;
+            if (buffer_sizes.empty()) {
+                buffer_sizes = {method.default_buffer_size};
+            }
+            std::vector<size_t> clamped;
+            for (size_t size : buffer_sizes) {
+                size = std::max(size, method.min_buffer_size);
+                if (std::find(clamped.begin(), clamped.end(), size) == clamped.end()) {
+                    clamped.push_back(size);
+                }
+            }
+            buffer_sizes = clamped;
+        } else if (method.sweep == SweepParameter::WindowSize) {
+            buffer_sizes = options.window_sizes;
+        }
+        std::vector<std::string> dst_paths;
+        for (size_t i = 0; i < src_paths.size(); ++i) {
+            dst_paths.push_back(destination_path(dst_prefix, i, src_paths.size(), method.suffix));
+        }
+        for (size_t buffer_size : buffer_sizes) {
+            BenchmarkResult result;
+            result.method = method.name;
+            result.file_size = static_cast<uint64_t>(file_size);
+            result.file_count = static_cast<unsigned>(src_paths.size());
+            result.buffer_size = buffer_size;
+
+            CopyInstrumentation instrumentation;
+            std::vector<CopyCost> costs;
+            unsigned total_runs = options.warmup_runs + options.repetitions;
+            for (unsigned run = 0; run < total_runs; ++run) {
+                // 每次运行都从冷缓存开始，并且上一次的目标文件已经落盘
+                for (size_t i = 0; i < src_paths.size(); ++i) {
+                    if (options.evict_cache) {
+                        evict_page_cache(src_paths[i]);
+                    }
+                    unlink(dst_paths[i].c_str());
+                }
+
+                bool rss_reset = reset_peak_rss();
+                bool ok = true;
+                instrumentation.start();
+                auto elapsed = measure_time([&]() {
+                    for (size_t i = 0; i < src_paths.size() && ok; ++i) {
+                        ok = method.copy(src_paths[i], dst_paths[i], buffer_size);
+                    }
+                });
+                CopyCost cost = instrumentation.stop();
+                if (!ok) {
+                    result.ok = false;
+                    break;
+                }
+                if (options.evict_cache) {
+                    for (const auto& dst_path : dst_paths) {
+                        evict_page_cache(dst_path);
+                    }
+                }
+                if (run >= options.warmup_runs) {
+                    result.samples_us.push_back(static_cast<double>(elapsed.count()));
+                    costs.push_back(cost);
+                    if (rss_reset) {
+                        result.peak_rss_kb = std::max(result.peak_rss_kb, read_peak_rss_kb());
+                    }
+                }
+            }
+            if (result.ok) {
+                compute_statistics(result);
+                result.cost = average_cost(costs);
+                if (!method.proc_io_accounted) {
+                    result.cost.io_syscalls = result.cost.io_bytes = -1;
+                }
+            }
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+std::vector<BenchmarkResult> run_benchmark(const BenchmarkOptions& options) {
+    std::vector<BenchmarkResult> results;
+    unsigned file_count = std::max(1u, options.file_count);
+    for (uint64_t size : options.file_sizes) {
+        std::string base = options.work_dir + "/zero_copy_bench_" + format_size(size);
+        std::string dst_prefix = base + ".out";
+        std::vector<std::string> src_paths;
+        for (unsigned i = 0; i < file_count; ++i) {
+            src_paths.push_back(file_count > 1 ? base + "." + std::to_string(i) + ".bin" : base + ".bin");
+        }
+
+        std::cerr << "Benchmarking file size " << format_size(size);
+        if (file_count > 1) {
+            std::cerr << " x " << file_count << " files";
+        }
+        std::cerr << "..." << std::endl;
+        TestDataOptions data_options;
+        data_options.profile = options.data_profile;
+        bool created = true;
+        for (unsigned i = 0; i < file_count && created; ++i) {
+            data_options.seed = size + i;
+            created = generate_test_file(src_paths[i], size, data_options);
+        }
+
+        if (created) {
+            auto file_results = benchmark_files(src_paths, dst_prefix, options);
+            for (auto& result : file_results) {
+                result.data_profile = data_profile_name(options.data_profile);
+            }
+            results.insert(results.end(), file_results.begin(), file_results.end());
+        }
+
+        for (size_t i = 0; i < src_paths.size(); ++i) {
+            unlink(src_paths[i].c_str());
+            for (const auto& method : default_copy_methods()) {
+                unlink(destination_path(dst_prefix, i, src_paths.size(), method.suffix).c_str());
+            }
+        }
+    }
+    return results;
+}
+
+void print_results_table(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::left << std::setw(18) << "method"
+        << std::right << std::setw(10) << "size"
+        << std::setw(10) << "buffer"
+        << std::setw(14) << "min(us)"
+        << std::setw(14) << "median(us)"
+        << std::setw(14) << "p95(us)"
+        << std::setw(12) << "MB/s"
+        << std::setw(14) << "peak RSS(MB)" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (const auto& r : results) {
+        out << std::left << std::setw(18) << r.method
+            << std::right << std::setw(10) << format_workload(r)
+            << std::setw(10) << (r.buffer_size ? format_size(r.buffer_size) : std::string("-"));
+        if (!r.ok) {
+            out << std::setw(14) << "failed" << std::endl;
+            continue;
+        }
+        out << std::setw(14) << r.min_us
+            << std::setw(14) << r.median_us
+            << std::setw(14) << r.p95_us
+            << std::setw(12) << r.mb_per_s
+            << std::setw(14);
+        if (r.peak_rss_kb >= 0) {
+            out << r.peak_rss_kb / 1024.0 << std::endl;
+        } else {
+            out << "-" << std::endl;
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void print_cost_table(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    bool perf_user_only = false;
+    out << std::left << std::setw(18) << "method"
+        << std::right << std::setw(10) << "size"
+        << std::setw(10) << "buffer"
+        << std::setw(12) << "user ms/GB"
+        << std::setw(12) << "sys ms/GB"
+        << std::setw(14) << "syscalls/GB"
+        << std::setw(14) << "bytes/call"
+        << std::setw(12) << "minflt/GB"
+        << std::setw(8) << "majflt"
+        << std::setw(12) << "csw v/iv"
+        << std::setw(10) << "cycles/B"
+        << std::setw(8) << "IPC"
+        << std::setw(14) << "LLC miss/MB" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (const auto& r : results) {
+        out << std::left << std::setw(18) << r.method
+            << std::right << std::setw(10) << format_workload(r)
+            << std::setw(10) << (r.buffer_size ? format_size(r.buffer_size) : std::string("-"));
+        if (!r.ok || r.file_size == 0) {
+            out << std::setw(12) << "failed" << std::endl;
+            continue;
+        }
+        const CopyCost& c = r.cost;
+        double gb = total_bytes(r) / (1024.0 * 1024.0 * 1024.0);
+        double mb = total_bytes(r) / (1024.0 * 1024.0);
+        out << std::setw(12) << c.user_us / 1000.0 / gb
+            << std::setw(12) << c.system_us / 1000.0 / gb;
+        if (c.io_syscalls >= 0) {
+            out << std::setw(14) << c.io_syscalls / gb;
+            out << std::setw(14);
+            if (c.io_syscalls > 0 && c.io_bytes >= 0) {
+                out << static_cast<double>(c.io_bytes) / c.io_syscalls;
+            } else {
+                out << "-";
+            }
+        } else {
+            out << std::setw(14) << "-" << std::setw(14) << "-";
+        }
+        out << std::setw(12) << c.minor_faults / gb
+            << std::setw(8) << c.major_faults
+            << std::setw(12) << (std::to_string(c.voluntary_switches) + "/" + std::to_string(c.involuntary_switches));
+        if (c.perf_available) {
+            perf_user_only = perf_user_only || c.perf_user_only;
+            out << std::setprecision(2)
+                << std::setw(10) << c.cycles / total_bytes(r)
+                << std::setw(8) << (c.cycles > 0 ? static_cast<double>(c.instructions) / c.cycles : 0.0)
+                << std::setprecision(1)
+                << std::setw(14) << c.llc_misses / mb << std::endl;
+        } else {
+            out << std::setw(10) << "-" << std::setw(8) << "-" << std::setw(14) << "-" << std::endl;
+        }
+    }
+    if (perf_user_only) {
+        out << "(perf counters exclude kernel time: kernel.perf_event_paranoid is too restrictive)" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void write_results_json(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    out << "{\n  \"kernel\": \"" << json_escape(kernel_version()) << "\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"method\": \"" << json_escape(r.method) << "\""
+            << ", \"file_size\": " << r.file_size
+            << ", \"file_count\": " << r.file_count
+            << ", \"data_profile\": \"" << json_escape(r.data_profile) << '"'
+            << ", \"buffer_size\": " << r.buffer_size
+            << ", \"ok\": " << (r.ok ? "true" : "false")
+            << ", \"min_us\": " << r.min_us
+            << ", \"median_us\": " << r.median_us
+            << ", \"p95_us\": " << r.p95_us
+            << ", \"mean_us\": " << r.mean_us
+            << ", \"mb_per_s\": " << r.mb_per_s
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb
+            << ", \"user_us\": " << r.cost.user_us
+            << ", \"system_us\": " << r.cost.system_us
+            << ", \"io_syscalls\": " << r.cost.io_syscalls
+            << ", \"io_bytes\": " << r.cost.io_bytes
+            << ", \"minor_faults\": " << r.cost.minor_faults
+            << ", \"major_faults\": " << r.cost.major_faults
+            << ", \"voluntary_switches\": " << r.cost.voluntary_switches
+            << ", \"involuntary_switches\": " << r.cost.involuntary_switches
+            << ", \"cycles\": " << r.cost.cycles
+            << ", \"instructions\": " << r.cost.instructions
+            << ", \"llc_misses\": " << r.cost.llc_misses
+            << ", \"samples_us\": [";
+        for (size_t j = 0; j < r.samples_us.size(); ++j) {
+            out << (j ? ", " : "") << r.samples_us[j];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+void write_results_csv(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    std::string kernel = kernel_version();
+    out << "kernel,method,file_size,file_count,data_profile,buffer_size,ok,runs,min_us,median_us,p95_us,mean_us,mb_per_s,peak_rss_kb,"
+        << "user_us,system_us,io_syscalls,io_bytes,minor_faults,major_faults,"
+        << "voluntary_switches,involuntary_switches,cycles,instructions,llc_misses" << std::endl;
+    for (const auto& r : results) {
+        out << '"' << kernel << '"' << ',' << r.method << ',' << r.file_size << ',' << r.file_count << ',' << r.data_profile << ',' << r.buffer_size << ','
+            << (r.ok ? 1 : 0) << ',' << r.samples_us.size() << ','
+            << r.min_us << ',' << r.median_us << ',' << r.p95_us << ','
+            << r.mean_us << ',' << r.mb_per_s << ',' << r.peak_rss_kb << ','
+            << r.cost.user_us << ',' << r.cost.system_us << ',' << r.cost.io_syscalls << ','
+            << r.cost.io_bytes << ',' << r.cost.minor_faults << ',' << r.cost.major_faults << ','
+            << r.cost.voluntary_switches << ',' << r.cost.involuntary_switches << ','
+            << r.cost.cycles << ',' << r.cost.instructions << ',' << r.cost.llc_misses << std::endl;
+    }
+}
+
+void write_results(const std::vector<BenchmarkResult>& results, ReportFormat format, std::ostream& out) {
+    switch (format) {
+    case ReportFormat::Text:
+        print_results_table(results, out);
+        out << std::endl;
+        print_cost_table(results, out);
+        break;
+    case ReportFormat::Json:
+        write_results_json(results, out);
+        break;
+    case ReportFormat::Csv:
+        write_results_csv(results, out);
+        break;
+    }
+}
+
+} // namespace zero_copy
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include "copy_instrumentation.h"
+#include "test_data.h"
+
+namespace zero_copy {
+
+// 基准测试时对复制方法扫描的参数
+enum class SweepParameter {
+    None,           // 没有可调参数
+    BufferSize,     // 扫描BenchmarkOptions::buffer_sizes
+    WindowSize      // 扫描BenchmarkOptions::window_sizes
+};
+
+// 可参与基准测试的复制方法
+struct CopyMethod {
+    std::string name;       // 显示名称
+    std::string suffix;     // 目标文件后缀，如".mmap"
+    // 第三个参数为被扫描的缓冲区或窗口大小，没有可调参数时传入0
+    std::function<bool(const std::string&, const std::string&, size_t)> copy;
+    SweepParameter sweep = SweepParameter::None;
+    // 数据是否全部经过/proc/self/io统计的系统调用（read/write/sendfile/copy_file_range等），
+    // 否则开销表中的系统调用数只有零星的辅助调用，不代表复制本身
+    bool proc_io_accounted = true;
+    // 方法自己的默认缓冲区大小，BenchmarkOptions::buffer_sizes为空时使用
+    size_t default_buffer_size = 0;
+    // 扫描时小于这个值的缓冲区大小按这个值运行，重复的大小只测一次
+    size_t min_buffer_size = 0;
+};
+
+// 当前平台上可用的全部复制方法
+std::vector<CopyMethod> default_copy_methods();
+
+enum class ReportFormat {
+    Text,
+    Json,
+    Csv
+};
+
+struct BenchmarkOptions {
+    unsigned warmup_runs = 1;       // 不计入统计的预热次数
+    unsigned repetitions = 5;       // 计入统计的重复次数
+    bool evict_cache = true;        // 每次运行前把源和目标从页缓存中清除
+    std::vector<uint64_t> file_sizes = {1ull << 20, 64ull << 20, 256ull << 20};
+    unsigned file_count = 1;        // 每种大小生成的文件数，每次运行依次复制全部文件（小文件场景）
+    DataProfile data_profile = DataProfile::Random; // 生成的测试文件内容
+    // 为空时不扫描，每个方法使用自己的默认缓冲区大小
+    std::vector<size_t> buffer_sizes = {4096, 64 * 1024, 1024 * 1024};
+    std::vector<size_t> window_sizes = {64 * 1024 * 1024, 256 * 1024 * 1024};
+    std::string work_dir = ".";     // 生成测试文件的目录
+    std::vector<std::string> methods; // 为空表示测试全部方法
+};
+
+// 单个（方法, 文件大小, 缓冲区大小）组合的统计结果，时间单位为微秒
+struct BenchmarkResult {
+    std::string method;
+    uint64_t file_size = 0;
+    unsigned file_count = 1;        // 每次运行复制的文件数，吞吐量按总字节数计算
+    std::string data_profile;       // 生成的测试文件内容，测试已有文件时为空
+    size_t buffer_size = 0;         // 缓冲区或mmap窗口大小，没有可调参数时为0
+    bool ok = true;
+    std::vector<double> samples_us;
+    double min_us = 0;
+    double median_us = 0;
+    double p95_us = 0;
+    double mean_us = 0;
+    double mb_per_s = 0;            // 按中位数计算的吞吐量
+    long peak_rss_kb = -1;          // 所有运行中的最大常驻内存，无法获取时为-1
+    CopyCost cost;                  // 计入统计的运行的平均资源开销
+};
+
+// 重置进程的峰值常驻内存统计（Linux的/proc/self/clear_refs），成功返回true
+bool reset_peak_rss();
+
+// 读取进程的峰值常驻内存（KB），无法获取时返回-1
+long read_peak_rss_kb();
+
+// fsync后用POSIX_FADV_DONTNEED把文件从页缓存中清除
+bool evict_page_cache(const std::string& path);
+
+// 对已有的源文件测试所有方法，目标文件为dst_prefix加方法后缀
+std::vector<BenchmarkResult> benchmark_file(const std::string& src_path, const std::string& dst_prefix,
+                                            const BenchmarkOptions& options);
+
+// 每次运行依次复制src_paths中的全部文件，目标文件为dst_prefix加序号和方法后缀
+std::vector<BenchmarkResult> benchmark_files(const std::vector<std::string>& src_paths, const std::string& dst_prefix,
+                                             const BenchmarkOptions& options);
+
+// 按options.file_sizes和options.file_count生成测试文件并逐个测试，结束后删除生成的文件
+std::vector<BenchmarkResult> run_benchmark(const BenchmarkOptions& options);
+
+void print_results_table(const std::vector<BenchmarkResult>& results, std::ostream& out);
+// 按每GB数据折算的CPU时间、系统调用、缺页等开销
+void print_cost_table(const std::vector<BenchmarkResult>& results, std::ostream& out);
+void write_results_json(const std::vector<BenchmarkResult>& results, std::ostream& out);
+void write_results_csv(const std::vector<BenchmarkResult>& results, std::ostream& out);
+void write_results(const std::vector<BenchmarkResult>& results, ReportFormat format, std::ostream& out);
+
+} // namespace zero_copy
@@ -0,0 +1,231 @@
+#include "copy_instrumentation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace zero_copy {
+
+CopyCost average_cost(const std::vector<CopyCost>& costs) {
+    CopyCost avg;
+    if (costs.empty()) {
+        return avg;
+    }
+    double n = static_cast<double>(costs.size());
+    avg = costs.front();
+    for (size_t i = 1; i < costs.size(); ++i) {
+        const CopyCost& c = costs[i];
+        avg.wall_us += c.wall_us;
+        avg.user_us += c.user_us;
+        avg.system_us += c.system_us;
+        avg.minor_faults += c.minor_faults;
+        avg.major_faults += c.major_faults;
+        avg.voluntary_switches += c.voluntary_switches;
+        avg.involuntary_switches += c.involuntary_switches;
+        avg.io_syscalls = (avg.io_syscalls < 0 || c.io_syscalls < 0) ? -1 : avg.io_syscalls + c.io_syscalls;
+        avg.io_bytes = (avg.io_bytes < 0 || c.io_bytes < 0) ? -1 : avg.io_bytes + c.io_bytes;
+        avg.perf_available = avg.perf_available && c.perf_available;
+        avg.perf_user_only = avg.perf_user_only || c.perf_user_only;
+        avg.cycles = (avg.cycles < 0 || c.cycles < 0) ? -1 : avg.cycles + c.cycles;
+        avg.instructions = (avg.instructions < 0 || c.instructions < 0) ? -1 : avg.instructions + c.instructions;
+        avg.llc_misses = (avg.llc_misses < 0 || c.llc_misses < 0) ? -1 : avg.llc_misses + c.llc_misses;
+    }
+
+    avg.wall_us /= n;
+    avg.user_us /= n;
+    avg.system_us /= n;
+    avg.minor_faults = static_cast<long>(avg.minor_faults / n);
+    avg.major_faults = static_cast<long>(avg.major_faults / n);
+    avg.voluntary_switches = static_cast<long>(avg.voluntary_switches / n);
+    avg.involuntary_switches = static_cast<long>(avg.involuntary_switches / n);
+    if (avg.io_syscalls >= 0) {
+        avg.io_syscalls = static_cast<long>(avg.io_syscalls / n);
+    }
+    if (avg.io_bytes >= 0) {
+        avg.io_bytes = static_cast<long>(avg.io_bytes / n);
+    }
+    if (!avg.perf_available) {
+        avg.cycles = avg.instructions = avg.llc_misses = -1;
+    } else {
+        avg.cycles = static_cast<long long>(avg.cycles / n);
+        avg.instructions = static_cast<long long>(avg.instructions / n);
+        avg.llc_misses = static_cast<long long>(avg.llc_misses / n);
+    }
+    return avg;
+}
+
+namespace {
+
+double timeval_us(const struct timeval& tv) {
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+#ifdef __linux__
+// inherit使复制方法内部创建的线程也被统计
+int open_perf_counter(uint64_t config, bool exclude_kernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+CopyInstrumentation::CopyInstrumentation() {
+    perf_fds_[0] = perf_fds_[1] = perf_fds_[2] = -1;
+#ifdef __linux__
+    const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    // 零拷贝方法的主要开销在内核中，优先同时统计内核态
+    for (bool exclude_kernel : {false, true}) {
+        bool all_opened = true;
+        for (int i = 0; i < 3; ++i) {
+            perf_fds_[i] = open_perf_counter(configs[i], exclude_kernel);
+            if (perf_fds_[i] == -1) {
+                all_opened = false;
+                break;
+            }
+        }
+        if (all_opened) {
+            perf_user_only_ = exclude_kernel;
+            break;
+        }
+        for (int& fd : perf_fds_) {
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+#endif
+}
+
+CopyInstrumentation::~CopyInstrumentation() {
+    for (int fd : perf_fds_) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+CopyInstrumentation::Snapshot CopyInstrumentation::take_snapshot() {
+    Snapshot snapshot;
+    snapshot.wall_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        snapshot.user_us = timeval_us(usage.ru_utime);
+        snapshot.system_us = timeval_us(usage.ru_stime);
+        snapshot.minor_faults = usage.ru_minflt;
+        snapshot.major_faults = usage.ru_majflt;
+        snapshot.voluntary_switches = usage.ru_nvcsw;
+        snapshot.involuntary_switches = usage.ru_nivcsw;
+    }
+
+#ifdef __linux__
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    long value;
+    long syscr = -1, syscw = -1, rchar = -1, wchar = -1;
+    while (io >> key >> value) {
+        if (key == "syscr:") {
+            syscr = value;
+        } else if (key == "syscw:") {
+            syscw = value;
+        } else if (key == "rchar:") {
+            rchar = value;
+        } else if (key == "wchar:") {
+            wchar = value;
+        }
+    }
+    if (syscr >= 0 && syscw >= 0) {
+        snapshot.io_syscalls = syscr + syscw;
+    }
+    if (rchar >= 0 && wchar >= 0) {
+        snapshot.io_bytes = rchar + wchar;
+    }
+#endif
+    return snapshot;
+}
+
+void CopyInstrumentation::start() {
+#ifdef __linux__
+    for (int fd : perf_fds_) {
+        if (fd != -1) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+#endif
+    // 开始快照读取/proc/self/io的read()在取到计数之后才计入，会出现在结束快照中。
+    // 紧接着取两次快照，差值就是一次读取本身的开销，stop()时减去
+    Snapshot probe = take_snapshot();
+    start_ = take_snapshot();
+    probe_syscalls_ = probe.io_syscalls >= 0 && start_.io_syscalls >= 0 ? start_.io_syscalls - probe.io_syscalls : 0;
+    probe_bytes_ = probe.io_bytes >= 0 && start_.io_bytes >= 0 ? start_.io_bytes - probe.io_bytes : 0;
+#ifdef __linux__
+    for (int fd : perf_fds_) {
+        if (fd != -1) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+CopyCost CopyInstrumentation::stop() {
+    CopyCost cost;
+#ifdef __linux__
+    long long counters[3] = {-1, -1, -1};
+    bool perf_ok = perf_fds_[0] != -1;
+    for (int i = 0; i < 3 && perf_ok; ++i) {
+        ioctl(perf_fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        long long value = 0;
+        if (read(perf_fds_[i], &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+            perf_ok = false;
+            break;
+        }
+        counters[i] = value;
+    }
+    if (perf_ok) {
+        cost.perf_available = true;
+        cost.perf_user_only = perf_user_only_;
+        cost.cycles = counters[0];
+        cost.instructions = counters[1];
+        cost.llc_misses = counters[2];
+    }
+#endif
+
+    Snapshot end = take_snapshot();
+    cost.wall_us = end.wall_us - start_.wall_us;
+    cost.user_us = end.user_us - start_.user_us;
+    cost.system_us = end.system_us - start_.system_us;
+    cost.minor_faults = end.minor_faults - start_.minor_faults;
+    cost.major_faults = end.major_faults - start_.major_faults;
+    cost.voluntary_switches = end.voluntary_switches - start_.voluntary_switches;
+    cost.involuntary_switches = end.involuntary_switches - start_.involuntary_switches;
+    if (start_.io_syscalls >= 0 && end.io_syscalls >= 0) {
+        cost.io_syscalls = std::max(0L, end.io_syscalls - start_.io_syscalls - probe_syscalls_);
+    }
+    if (start_.io_bytes >= 0 && end.io_bytes >= 0) {
+        cost.io_bytes = std::max(0L, end.io_bytes - start_.io_bytes - probe_bytes_);
+    }
+    return cost;
+}
+
+} // namespace zero_copy
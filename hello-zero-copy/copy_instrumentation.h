@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace zero_copy {
+
+// 一次复制的资源开销（整个进程范围，包含复制方法内部创建的线程）
+struct CopyCost {
+    double wall_us = 0;
+    double user_us = 0;                 // 用户态CPU时间
+    double system_us = 0;               // 内核态CPU时间
+    long minor_faults = 0;
+    long major_faults = 0;
+    long voluntary_switches = 0;
+    long involuntary_switches = 0;
+    // 来自/proc/self/io：read/pread/sendfile/copy_file_range等计入syscr/syscw，
+    // splice、tee、io_uring和mmap缺页不计入，这些方法的基准测试结果中为-1。
+    // 已经减去读取/proc/self/io本身的系统调用和字节数
+    long io_syscalls = -1;
+    long io_bytes = -1;                 // rchar + wchar
+    // 来自perf_event_open，不可用时为-1
+    bool perf_available = false;
+    bool perf_user_only = false;        // perf_event_paranoid不允许统计内核态时只统计用户态
+    long long cycles = -1;
+    long long instructions = -1;
+    long long llc_misses = -1;
+};
+
+// 多次测量的平均值；任一次测量中不可用的计数器在结果中也不可用
+CopyCost average_cost(const std::vector<CopyCost>& costs);
+
+// 采集一段代码的开销：构造后调用start()，执行被测代码后调用stop()
+class CopyInstrumentation {
+public:
+    CopyInstrumentation();
+    ~CopyInstrumentation();
+
+    CopyInstrumentation(const CopyInstrumentation&) = delete;
+    CopyInstrumentation& operator=(const CopyInstrumentation&) = delete;
+
+    void start();
+    CopyCost stop();
+
+private:
+    // 进程级计数器的一次快照
+    struct Snapshot {
+        double wall_us = 0;
+        double user_us = 0;
+        double system_us = 0;
+        long minor_faults = 0;
+        long major_faults = 0;
+        long voluntary_switches = 0;
+        long involuntary_switches = 0;
+        long io_syscalls = -1;
+        long io_bytes = -1;
+    };
+
+    static Snapshot take_snapshot();
+
+    int perf_fds_[3];
+    bool perf_user_only_ = false;
+    Snapshot start_;
+    // 开始快照读取/proc/self/io时自身计入的系统调用和字节数
+    long probe_syscalls_ = 0;
+    long probe_bytes_ = 0;
+};
+
+// 测量func的开销
+template<typename Func>
+CopyCost measure_cost(Func&& func) {
+    CopyInstrumentation instrumentation;
+    instrumentation.start();
+    std::forward<Func>(func)();
+    return instrumentation.stop();
+}
+
+} // namespace zero_copy
@@ -0,0 +1,308 @@
+#include "copy_scheduler.h"
+#include "zero_copy_examples.h"
+
+#include <algorithm>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+// 限速时每次休眠的最长时间，保证取消请求能被及时响应
+const std::chrono::milliseconds kMaxThrottleSleep(50);
+
+// 复制一个块，优先使用copy_file_range，不支持时退回pread/pwrite
+bool copy_chunk(int src_fd, int dst_fd, off_t offset, size_t length,
+                bool& use_copy_file_range, std::vector<char>& buffer, std::string& error) {
+#ifdef __linux__
+    while (use_copy_file_range && length > 0) {
+        off_t offset_in = offset;
+        off_t offset_out = offset;
+        ssize_t copied = copy_file_range(src_fd, &offset_in, dst_fd, &offset_out, length, 0);
+        if (copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL) {
+                use_copy_file_range = false;
+                break;
+            }
+            error = std::string("Error during copy_file_range: ") + strerror(errno);
+            return false;
+        }
+        if (copied == 0) {
+            error = "Error: source file was truncated during copy";
+            return false;
+        }
+        offset += copied;
+        length -= copied;
+    }
+#else
+    use_copy_file_range = false;
+#endif
+
+    if (length > 0 && buffer.empty()) {
+        buffer.resize(1024 * 1024);
+    }
+    while (length > 0) {
+        ssize_t bytes_read = pread(src_fd, buffer.data(), std::min(length, buffer.size()), offset);
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("Error reading from source file: ") + strerror(errno);
+            return false;
+        }
+        if (bytes_read == 0) {
+            error = "Error: source file was truncated during copy";
+            return false;
+        }
+        ssize_t done = 0;
+        while (done < bytes_read) {
+            ssize_t bytes_written = pwrite(dst_fd, buffer.data() + done, bytes_read - done, offset + done);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = std::string("Error writing to destination file: ") + strerror(errno);
+                return false;
+            }
+            done += bytes_written;
+        }
+        offset += bytes_read;
+        length -= bytes_read;
+    }
+    return true;
+}
+
+} // namespace
+
+CopyScheduler::CopyScheduler(unsigned workers, uint64_t bandwidth_limit)
+    : bandwidth_limit_(bandwidth_limit)
+    , last_refill_(std::chrono::steady_clock::now()) {
+    workers = std::max(1u, workers);
+    workers_.reserve(workers);
+    try {
+        for (unsigned i = 0; i < workers; ++i) {
+            workers_.emplace_back(&CopyScheduler::worker_loop, this);
+        }
+    } catch (const std::system_error&) {
+        // 至少有一个线程时照常工作，一个都没有则无法执行任务
+        if (workers_.empty()) {
+            throw;
+        }
+    }
+}
+
+CopyScheduler::~CopyScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cancel_all();
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::future<CopyResult> CopyScheduler::submit(CopyJob job) {
+    QueuedJob queued;
+    queued.job = std::move(job);
+    std::future<CopyResult> future = queued.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            CopyResult result;
+            result.cancelled = true;
+            result.error = "scheduler is shutting down";
+            queued.promise.set_value(result);
+            return future;
+        }
+        queue_.push_back(std::move(queued));
+    }
+    cv_.notify_one();
+    return future;
+}
+
+void CopyScheduler::set_bandwidth_limit(uint64_t bytes_per_second) {
+    std::lock_guard<std::mutex> lock(bucket_mutex_);
+    bandwidth_limit_ = bytes_per_second;
+    tokens_ = 0;
+    last_refill_ = std::chrono::steady_clock::now();
+}
+
+void CopyScheduler::cancel_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& queued : queue_) {
+        queued.job.cancel_token.cancel();
+    }
+    for (auto* token : running_tokens_) {
+        token->cancel();
+    }
+}
+
+size_t CopyScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void CopyScheduler::worker_loop() {
+    for (;;) {
+        QueuedJob queued;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            queued = std::move(queue_.front());
+            queue_.pop_front();
+            running_tokens_.push_back(&queued.job.cancel_token);
+        }
+
+        CopyResult result;
+        try {
+            result = run_job(queued.job);
+        } catch (const std::exception& e) {
+            // 任务中的异常（例如内存分配失败）不能让工作线程退出
+            result.ok = false;
+            result.error = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_tokens_.erase(std::find(running_tokens_.begin(), running_tokens_.end(),
+                                            &queued.job.cancel_token));
+        }
+        queued.promise.set_value(result);
+    }
+}
+
+void CopyScheduler::throttle(uint64_t bytes, const CancellationToken& token) {
+    std::chrono::duration<double> wait(0);
+    {
+        std::lock_guard<std::mutex> lock(bucket_mutex_);
+        if (bandwidth_limit_ == 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        last_refill_ = now;
+        // 最多累积0.1秒的突发额度
+        double burst = bandwidth_limit_ * 0.1;
+        tokens_ = std::min(burst, tokens_ + elapsed * bandwidth_limit_);
+        // 先扣除再等待，令牌为负时表示后来者需要排队等待更久
+        tokens_ -= static_cast<double>(bytes);
+        if (tokens_ < 0) {
+            wait = std::chrono::duration<double>(-tokens_ / bandwidth_limit_);
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+    while (!token.cancelled()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, kMaxThrottleSleep));
+    }
+}
+
+CopyResult CopyScheduler::run_job(CopyJob& job) {
+    CopyResult result;
+    auto start = std::chrono::steady_clock::now();
+    auto finish = [&]() {
+        result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        return result;
+    };
+
+    if (job.cancel_token.cancelled()) {
+        result.cancelled = true;
+        return finish();
+    }
+    size_t chunk_size = job.chunk_size > 0 ? job.chunk_size : 4 * 1024 * 1024;
+
+    int src_fd = open(job.src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        result.error = std::string("Error opening source file: ") + strerror(errno);
+        return finish();
+    }
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        result.error = std::string("Error getting file size: ") + strerror(errno);
+        close(src_fd);
+        return finish();
+    }
+    int dst_fd = open(job.dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        result.error = std::string("Error opening destination file: ") + strerror(errno);
+        close(src_fd);
+        return finish();
+    }
+
+    bool use_copy_file_range = true;
+    std::vector<char> buffer;
+    CopyProgress progress;
+    progress.total_bytes = static_cast<uint64_t>(src_size);
+
+    bool success = true;
+    off_t offset = 0;
+    while (offset < src_size) {
+        if (job.cancel_token.cancelled()) {
+            result.cancelled = true;
+            success = false;
+            break;
+        }
+        size_t length = static_cast<size_t>(std::min<off_t>(chunk_size, src_size - offset));
+        throttle(length, job.cancel_token);
+        if (job.cancel_token.cancelled()) {
+            result.cancelled = true;
+            success = false;
+            break;
+        }
+        if (!copy_chunk(src_fd, dst_fd, offset, length, use_copy_file_range, buffer, result.error)) {
+            success = false;
+            break;
+        }
+        offset += length;
+
+        progress.bytes_done = static_cast<uint64_t>(offset);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        progress.bytes_per_second = seconds > 0 ? progress.bytes_done / seconds : 0;
+        if (job.on_progress) {
+            // 回调抛出异常时按失败处理，仍然要关闭文件并删除不完整的目标文件
+            try {
+                job.on_progress(progress);
+            } catch (const std::exception& e) {
+                result.error = std::string("Progress callback failed: ") + e.what();
+                success = false;
+                break;
+            } catch (...) {
+                result.error = "Progress callback failed";
+                success = false;
+                break;
+            }
+        }
+    }
+
+    close(src_fd);
+    close(dst_fd);
+
+    result.bytes_copied = static_cast<uint64_t>(offset);
+    result.ok = success;
+    if (!success) {
+        // 不保留不完整的目标文件
+        unlink(job.dst_path.c_str());
+    }
+    return finish();
+}
+
+} // namespace zero_copy
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 协作式取消标志，可以复制后交给其他线程使用
+class CancellationToken {
+public:
+    CancellationToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { flag_->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return flag_->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+struct CopyProgress {
+    uint64_t bytes_done = 0;
+    uint64_t total_bytes = 0;
+    double bytes_per_second = 0;    // 从任务开始到现在的平均速率
+};
+
+struct CopyJob {
+    std::string src_path;
+    std::string dst_path;
+    // 每复制完一块在工作线程中调用，回调应尽快返回
+    std::function<void(const CopyProgress&)> on_progress;
+    // 调用方保留一份副本，调用cancel()即可在下一个块边界停止任务
+    CancellationToken cancel_token;
+    size_t chunk_size = 4 * 1024 * 1024;
+};
+
+struct CopyResult {
+    bool ok = false;
+    bool cancelled = false;
+    uint64_t bytes_copied = 0;
+    std::chrono::microseconds elapsed{0};
+    std::string error;
+};
+
+// 异步复制调度器
+// 固定数量的工作线程处理提交的任务，所有任务共享一个全局带宽上限。
+// 任务按块复制，在块边界上报告进度、检查取消并接受限速。
+class CopyScheduler {
+public:
+    // bandwidth_limit为每秒字节数，0表示不限速
+    explicit CopyScheduler(unsigned workers = 4, uint64_t bandwidth_limit = 0);
+    // 取消所有未开始和正在执行的任务，并等待工作线程退出
+    ~CopyScheduler();
+
+    CopyScheduler(const CopyScheduler&) = delete;
+    CopyScheduler& operator=(const CopyScheduler&) = delete;
+
+    std::future<CopyResult> submit(CopyJob job);
+
+    // 修改全局带宽上限，对正在执行的任务立即生效
+    void set_bandwidth_limit(uint64_t bytes_per_second);
+
+    // 请求取消所有已提交的任务
+    void cancel_all();
+
+    // 排队中尚未开始的任务数
+    size_t pending() const;
+
+private:
+    struct QueuedJob {
+        CopyJob job;
+        std::promise<CopyResult> promise;
+    };
+
+    void worker_loop();
+    CopyResult run_job(CopyJob& job);
+    // 为即将复制的bytes个字节申请带宽，必要时休眠；任务被取消时提前返回
+    void throttle(uint64_t bytes, const CancellationToken& token);
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<QueuedJob> queue_;
+    std::vector<CancellationToken*> running_tokens_;   // 正在执行的任务的取消标志
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    // 令牌桶限速
+    std::mutex bucket_mutex_;
+    uint64_t bandwidth_limit_;
+    double tokens_ = 0;
+    std::chrono::steady_clock::time_point last_refill_;
+};
+
+} // namespace zero_copy
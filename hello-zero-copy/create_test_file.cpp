@@ -1,76 +1,22 @@
+#include "test_data.h"
 #include <iostream>
-#include <fstream>
-#include <random>
 #include <string>
-#include <algorithm>
-
-// 创建一个指定大小的测试文件，填充随机数据
-void create_random_file(const std::string& path, size_t size_mb) {
-    std::cout << "Creating test file: " << path << " (" << size_mb << " MB)" << std::endl;
-    
-    // 打开输出文件流
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Error: Could not open file for writing: " << path << std::endl;
-        return;
-    }
-    
-    // 设置随机数生成器
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 255);
-    
-    // 计算总字节数
-    size_t total_bytes = size_mb * 1024 * 1024;
-    
-    // 使用缓冲区提高写入效率
-    const size_t buffer_size = 64 * 1024; // 64KB buffer
-    char buffer[buffer_size];
-    
-    // 写入随机数据
-    size_t bytes_written = 0;
-    size_t percent_done = 0;
-    
-    while (bytes_written < total_bytes) {
-        // 填充缓冲区
-        for (size_t i = 0; i < buffer_size && bytes_written + i < total_bytes; ++i) {
-            buffer[i] = static_cast<char>(distrib(gen));
-        }
-        
-        // 计算本次写入的字节数
-        size_t bytes_to_write = std::min(buffer_size, total_bytes - bytes_written);
-        
-        // 写入文件
-        file.write(buffer, bytes_to_write);
-        if (!file) {
-            std::cerr << "Error: Failed to write to file: " << path << std::endl;
-            file.close();
-            return;
-        }
-        
-        bytes_written += bytes_to_write;
-        
-        // 显示进度
-        size_t new_percent = (bytes_written * 100) / total_bytes;
-        if (new_percent > percent_done) {
-            percent_done = new_percent;
-            std::cout << "\rProgress: " << percent_done << "%" << std::flush;
-        }
-    }
-    
-    file.close();
-    std::cout << "\nTest file created successfully: " << path << " (" << size_mb << " MB)" << std::endl;
-}
+#include <chrono>
+#include <random>
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " <output_file_path> <size_in_MB>" << std::endl;
-        std::cout << "Example: " << argv[0] << " test_file.bin 100" << std::endl;
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <output_file_path> <size_in_MB> [options]" << std::endl;
+        std::cout << "Example: " << argv[0] << " test_file.bin 100 --profile text" << std::endl;
+        std::cout << "\nOptions:" << std::endl;
+        std::cout << "  --profile <name>    random, zeros, text, sparse or repeated (default random)" << std::endl;
+        std::cout << "  --threads <n>       generator threads (default: hardware concurrency)" << std::endl;
+        std::cout << "  --seed <n>          seed for reproducible content (default: random)" << std::endl;
         return 1;
     }
-    
+
     std::string file_path = argv[1];
-    
+
     // 解析文件大小参数
     size_t size_mb;
     try {
@@ -82,8 +28,57 @@ int main(int argc, char* argv[]) {
         std::cerr << "Error: Invalid size parameter. Please provide a positive integer." << std::endl;
         return 1;
     }
-    
-    create_random_file(file_path, size_mb);
-    
+
+    zero_copy::TestDataOptions options;
+    options.seed = (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()();
+    try {
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "Error: missing value for " << arg << std::endl;
+                return 1;
+            }
+            if (arg == "--profile") {
+                std::string name = argv[++i];
+                if (!zero_copy::parse_data_profile(name, options.profile)) {
+                    std::cerr << "Error: unknown profile " << name << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--threads") {
+                options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(argv[++i]);
+            } else {
+                std::cerr << "Error: unknown option " << arg << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Creating test file: " << file_path << " (" << size_mb << " MB, "
+              << zero_copy::data_profile_name(options.profile) << ")" << std::endl;
+
+    // 显示进度
+    uint64_t percent_done = 0;
+    options.on_progress = [&percent_done](uint64_t done, uint64_t total) {
+        uint64_t new_percent = done * 100 / total;
+        if (new_percent > percent_done) {
+            percent_done = new_percent;
+            std::cout << "\rProgress: " << percent_done << "%" << std::flush;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (!zero_copy::generate_test_file(file_path, static_cast<uint64_t>(size_mb) * 1024 * 1024, options)) {
+        std::cerr << "\nError: Failed to create test file: " << file_path << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "\nTest file created successfully: " << file_path << " (" << size_mb << " MB in "
+              << seconds << " s)" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
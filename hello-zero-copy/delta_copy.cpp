@@ -0,0 +1,227 @@
+#include "delta_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+// 每个线程一次领取的块数，块很小时减少原子操作的争用
+const uint64_t kBlocksPerTask = 16;
+
+// 所有工作线程共享的状态
+struct DeltaCopyState {
+    int src_fd = -1;
+    int dst_fd = -1;
+    off_t src_size = 0;
+    off_t dst_size = 0;
+    size_t block_size = 0;
+    uint64_t block_count = 0;
+    std::atomic<uint64_t> next_task{0};
+    std::atomic<uint64_t> blocks_changed{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<bool> abort{false};
+    std::mutex error_mutex;
+    std::string error;
+
+    // 记录第一个错误并通知其他线程停止
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error.empty()) {
+            error = message;
+        }
+        abort.store(true, std::memory_order_relaxed);
+    }
+};
+
+// 读满length字节，返回实际读到的字节数（到达文件末尾时可能更少），出错返回-1
+ssize_t read_full(int fd, char* buffer, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, offset + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return static_cast<ssize_t>(done);
+}
+
+bool write_full(int fd, const char* buffer, size_t length, off_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, buffer, length, offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buffer += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+void delta_worker(DeltaCopyState& state) {
+    std::vector<char> src_block(state.block_size);
+    std::vector<char> dst_block(state.block_size);
+
+    while (!state.abort.load(std::memory_order_relaxed)) {
+        uint64_t first = state.next_task.fetch_add(1, std::memory_order_relaxed) * kBlocksPerTask;
+        if (first >= state.block_count) {
+            break;
+        }
+        uint64_t last = std::min(first + kBlocksPerTask, state.block_count);
+        for (uint64_t block = first; block < last && !state.abort.load(std::memory_order_relaxed); ++block) {
+            off_t offset = static_cast<off_t>(block * state.block_size);
+            size_t length = static_cast<size_t>(std::min<off_t>(state.block_size, state.src_size - offset));
+
+            ssize_t src_read = read_full(state.src_fd, src_block.data(), length, offset);
+            if (src_read == -1) {
+                state.fail(std::string("Error reading from source file: ") + strerror(errno));
+                return;
+            }
+            if (static_cast<size_t>(src_read) != length) {
+                state.fail("Error: source file was truncated during copy");
+                return;
+            }
+
+            // 两个文件都在本地，直接比较内容，不存在哈希碰撞导致漏写的问题
+            bool same = false;
+            if (offset < state.dst_size) {
+                size_t dst_length = static_cast<size_t>(std::min<off_t>(length, state.dst_size - offset));
+                ssize_t dst_read = read_full(state.dst_fd, dst_block.data(), dst_length, offset);
+                if (dst_read == -1) {
+                    state.fail(std::string("Error reading from destination file: ") + strerror(errno));
+                    return;
+                }
+                same = static_cast<size_t>(dst_read) == length &&
+                       memcmp(src_block.data(), dst_block.data(), length) == 0;
+            }
+            if (same) {
+                continue;
+            }
+
+            if (!write_full(state.dst_fd, src_block.data(), length, offset)) {
+                state.fail(std::string("Error writing to destination file: ") + strerror(errno));
+                return;
+            }
+            state.blocks_changed.fetch_add(1, std::memory_order_relaxed);
+            state.bytes_written.fetch_add(length, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace
+
+bool delta_copy(const std::string& src_path, const std::string& dst_path,
+                DeltaCopyStats* stats, size_t block_size, unsigned threads) {
+    DeltaCopyStats local_stats;
+    DeltaCopyStats& st = stats ? *stats : local_stats;
+    st = DeltaCopyStats();
+    auto start = std::chrono::steady_clock::now();
+
+    if (block_size == 0) {
+        std::cerr << "Error: block size must be greater than 0" << std::endl;
+        return false;
+    }
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        return false;
+    }
+
+    st.destination_existed = access(dst_path.c_str(), F_OK) == 0;
+    // 不使用O_TRUNC，保留目标文件中未改变的数据
+    int dst_fd = open(dst_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+    off_t dst_size = get_file_size(dst_fd);
+    if (dst_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(dst_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    DeltaCopyState state;
+    state.src_fd = src_fd;
+    state.dst_fd = dst_fd;
+    state.src_size = src_size;
+    state.dst_size = dst_size;
+    state.block_size = block_size;
+    state.block_count = (static_cast<uint64_t>(src_size) + block_size - 1) / block_size;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    uint64_t tasks = (state.block_count + kBlocksPerTask - 1) / kBlocksPerTask;
+    threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threads, tasks)));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(delta_worker, std::ref(state));
+        }
+    } catch (const std::system_error&) {
+        // 线程创建失败时由已有线程和当前线程完成剩余的块
+    }
+    delta_worker(state);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    bool success = !state.abort.load();
+    if (success && dst_size != src_size && ftruncate(dst_fd, src_size) == -1) {
+        state.error = std::string("Error setting destination file size: ") + strerror(errno);
+        success = false;
+    }
+    close(src_fd);
+    close(dst_fd);
+    if (!success) {
+        std::cerr << state.error << std::endl;
+        return false;
+    }
+
+    st.file_size = static_cast<uint64_t>(src_size);
+    st.blocks_total = state.block_count;
+    st.blocks_changed = state.blocks_changed.load();
+    st.bytes_written = state.bytes_written.load();
+    st.bytes_skipped = st.file_size - st.bytes_written;
+    st.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+} // namespace zero_copy
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 增量复制的统计信息
+struct DeltaCopyStats {
+    uint64_t file_size = 0;
+    uint64_t blocks_total = 0;
+    uint64_t blocks_changed = 0;
+    uint64_t bytes_written = 0;         // 实际写入目标文件的字节数
+    uint64_t bytes_skipped = 0;         // 内容相同而没有写入的字节数
+    bool destination_existed = false;   // 目标文件不存在时所有块都需要写入
+    std::chrono::microseconds elapsed{0};
+};
+
+// 增量复制：只重写目标文件中与源文件不同的块
+// 源文件和目标文件按block_size分块，由threads个线程并行读取并比较，
+// 不同的块用pwrite原地写入，最后把目标文件截断或扩展到源文件的大小。
+// threads为0时使用硬件并发数。目标文件是原地修改的，复制中途失败时其内容是新旧数据的混合。
+bool delta_copy(const std::string& src_path, const std::string& dst_path,
+                DeltaCopyStats* stats = nullptr, size_t block_size = 1024 * 1024, unsigned threads = 0);
+
+} // namespace zero_copy
@@ -0,0 +1,278 @@
+#include "direct_io_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+// O_DIRECT要求缓冲区地址、文件偏移和长度都按逻辑块大小对齐，4096覆盖常见设备
+const size_t kDirectAlignment = 4096;
+
+// 在读线程和写线程之间传递的一个数据块
+struct Block {
+    unsigned index = 0;     // 缓冲区编号
+    off_t offset = 0;
+    size_t length = 0;      // 为0表示读线程已到达文件末尾
+};
+
+// 简单的阻塞队列，abort后所有等待者立即返回
+class BlockQueue {
+public:
+    void push(const Block& block) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            blocks_.push_back(block);
+        }
+        cv_.notify_one();
+    }
+
+    bool pop(Block& block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return aborted_ || !blocks_.empty(); });
+        if (aborted_) {
+            return false;
+        }
+        block = blocks_.front();
+        blocks_.pop_front();
+        return true;
+    }
+
+    void abort() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            aborted_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Block> blocks_;
+    bool aborted_ = false;
+};
+
+// 以指定标志打开文件；请求O_DIRECT但文件系统不支持时去掉该标志重试
+int open_maybe_direct(const std::string& path, int flags, bool& direct) {
+#ifdef O_DIRECT
+    if (direct) {
+        int fd = open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd != -1 || errno != EINVAL) {
+            return fd;
+        }
+        direct = false;
+    }
+#else
+    direct = false;
+#endif
+    return open(path.c_str(), flags, 0644);
+}
+
+} // namespace
+
+bool direct_io_copy(const std::string& src_path, const std::string& dst_path,
+                    size_t buffer_size, unsigned buffer_count) {
+    if (buffer_size == 0 || buffer_count == 0) {
+        std::cerr << "Error: buffer size and buffer count must be greater than 0" << std::endl;
+        return false;
+    }
+    buffer_size = (buffer_size + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment;
+
+    bool src_direct = true;
+    int src_fd = open_maybe_direct(src_path, O_RDONLY, src_direct);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool dst_direct = true;
+    int dst_fd = open_maybe_direct(dst_path, O_WRONLY | O_CREAT | O_TRUNC, dst_direct);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    if (!src_direct || !dst_direct) {
+        std::cerr << "O_DIRECT not supported for "
+                  << (!src_direct ? (!dst_direct ? "source and destination" : "source") : "destination")
+                  << ", falling back to buffered I/O with cache dropping" << std::endl;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+
+    // 对齐的缓冲区池
+    std::vector<char*> buffers(buffer_count, nullptr);
+    for (auto& buffer : buffers) {
+        void* mem = nullptr;
+        if (posix_memalign(&mem, kDirectAlignment, buffer_size) != 0) {
+            std::cerr << "Error allocating aligned buffers" << std::endl;
+            for (char* b : buffers) {
+                free(b);
+            }
+            close(src_fd);
+            close(dst_fd);
+            return false;
+        }
+        buffer = static_cast<char*>(mem);
+    }
+
+    BlockQueue free_blocks;
+    BlockQueue full_blocks;
+    for (unsigned i = 0; i < buffer_count; ++i) {
+        Block block;
+        block.index = i;
+        free_blocks.push(block);
+    }
+
+    std::mutex error_mutex;
+    std::string error;
+    auto fail = [&](const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error.empty()) {
+                error = message;
+            }
+        }
+        free_blocks.abort();
+        full_blocks.abort();
+    };
+
+    // 读线程：取空闲缓冲区，读满后交给写线程
+    auto reader = [&]() {
+        off_t offset = 0;
+        Block block;
+        while (offset < src_size && free_blocks.pop(block)) {
+            size_t filled = 0;
+            while (filled < buffer_size) {
+                ssize_t bytes_read = pread(src_fd, buffers[block.index] + filled,
+                                           buffer_size - filled, offset + filled);
+                if (bytes_read == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    fail(std::string("Error reading from source file: ") + strerror(errno));
+                    return;
+                }
+                if (bytes_read == 0) {
+                    break;
+                }
+                filled += bytes_read;
+                // O_DIRECT下文件末尾会返回不足一个块的数据，之后的偏移不再对齐
+                if (filled % kDirectAlignment != 0) {
+                    break;
+                }
+            }
+            if (filled == 0) {
+                break;
+            }
+            block.offset = offset;
+            block.length = filled;
+            full_blocks.push(block);
+            offset += filled;
+            if (filled < buffer_size) {
+                break;
+            }
+        }
+        // 通知写线程结束
+        full_blocks.push(Block());
+    };
+
+    // 写线程：写出已填充的缓冲区后归还到空闲队列
+    auto writer = [&]() {
+        Block block;
+        while (full_blocks.pop(block)) {
+            if (block.length == 0) {
+                return;
+            }
+            const char* data = buffers[block.index];
+            size_t aligned = block.length / kDirectAlignment * kDirectAlignment;
+            size_t done = 0;
+            while (done < block.length) {
+                // 未对齐的尾部无法用O_DIRECT写入，先关闭O_DIRECT再普通写入
+                if (done == aligned && dst_direct) {
+                    int flags = fcntl(dst_fd, F_GETFL);
+#ifdef O_DIRECT
+                    if (flags == -1 || fcntl(dst_fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+                        fail(std::string("Error clearing O_DIRECT: ") + strerror(errno));
+                        return;
+                    }
+#endif
+                    dst_direct = false;
+                }
+                size_t end = (dst_direct && done < aligned) ? aligned : block.length;
+                ssize_t bytes_written = pwrite(dst_fd, data + done, end - done, block.offset + done);
+                if (bytes_written == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    fail(std::string("Error writing to destination file: ") + strerror(errno));
+                    return;
+                }
+                done += bytes_written;
+            }
+#if defined(POSIX_FADV_DONTNEED)
+            // 退回普通I/O时尽量不污染页缓存
+            if (!src_direct) {
+                posix_fadvise(src_fd, block.offset, block.length, POSIX_FADV_DONTNEED);
+            }
+            if (!dst_direct) {
+#ifdef __linux__
+                sync_file_range(dst_fd, block.offset, block.length,
+                                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+                posix_fadvise(dst_fd, block.offset, block.length, POSIX_FADV_DONTNEED);
+            }
+#endif
+            free_blocks.push(block);
+        }
+    };
+
+    std::thread reader_thread;
+    std::thread writer_thread;
+    try {
+        reader_thread = std::thread(reader);
+        writer_thread = std::thread(writer);
+    } catch (const std::system_error& e) {
+        fail(std::string("Error starting copy threads: ") + e.what());
+    }
+    if (reader_thread.joinable()) {
+        reader_thread.join();
+    }
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+
+    for (char* buffer : buffers) {
+        free(buffer);
+    }
+    close(src_fd);
+    close(dst_fd);
+
+    if (!error.empty()) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace zero_copy
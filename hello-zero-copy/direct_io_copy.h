@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace zero_copy {
+
+// 使用O_DIRECT绕过页缓存的复制方法
+// 读线程和写线程在buffer_count个对齐缓冲区之间轮转，使读和写重叠进行。
+// buffer_size会向上取整到4096字节的整数倍；文件系统拒绝O_DIRECT时
+// 退回普通I/O，并在写完每个块后把它从页缓存中丢弃。
+bool direct_io_copy(const std::string& src_path, const std::string& dst_path,
+                    size_t buffer_size = 1024 * 1024, unsigned buffer_count = 2);
+
+} // namespace zero_copy
@@ -1,35 +1,429 @@
 #include "zero_copy_examples.h"
+#include "copy_benchmark.h"
+#include "sparse_copy.h"
+#include "delta_copy.h"
+#include "tree_copy.h"
+#include "auto_copy.h"
+#include "paced_copy.h"
+#include "compressed_copy.h"
+#include "verified_copy.h"
+#include "checksum.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <cstring>
 #include <unistd.h>
 
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " <source_file> <destination_file>" << std::endl;
+    std::cout << "       " << program_name << " --benchmark [options]" << std::endl;
+    std::cout << "       " << program_name << " --sparse <source_file> <destination_file>" << std::endl;
+    std::cout << "       " << program_name << " --delta <source_file> <destination_file> [block_size]" << std::endl;
+    std::cout << "       " << program_name << " --tree <source_dir> <destination_dir> [threads]" << std::endl;
+    std::cout << "       " << program_name << " --auto <source_file> <destination_file> [--recalibrate]" << std::endl;
+    std::cout << "       " << program_name << " --paced <source_file> <destination_file> [readahead] [writeback] [dirty_limit]" << std::endl;
+    std::cout << "       " << program_name << " --compress <source_file> <destination_file> [zstd|lz4|stored]" << std::endl;
+    std::cout << "       " << program_name << " --decompress <source_file> <destination_file>" << std::endl;
+    std::cout << "       " << program_name << " --verify <source_file> <destination_file> [buffered|mmap|splice]" << std::endl;
     std::cout << "\nThis program demonstrates and compares different file copy methods:" << std::endl;
     std::cout << "1. Traditional copy (using read/write system calls)" << std::endl;
-    std::cout << "2. Zero-copy using mmap/munmap" << std::endl;
+    std::cout << "2. Zero-copy using mmap/munmap (whole file and sliding window)" << std::endl;
 #if defined(__linux__) || defined(__APPLE__)
     std::cout << "3. Zero-copy using sendfile" << std::endl;
 #endif
 #ifdef __linux__
     std::cout << "4. Zero-copy using splice" << std::endl;
+    std::cout << "5. In-kernel copy using copy_file_range" << std::endl;
+    std::cout << "6. Batched asynchronous copy using io_uring" << std::endl;
 #endif
+    std::cout << "7. Parallel chunked copy using a worker pool" << std::endl;
+    std::cout << "8. Page-cache bypassing copy using O_DIRECT" << std::endl;
+    std::cout << "9. Hole-preserving copy using FICLONE or SEEK_DATA/SEEK_HOLE" << std::endl;
+    std::cout << "10. Copy with inline CRC32C checksum (buffered, mmap and splice+tee)" << std::endl;
     std::cout << "\nThe program will create multiple copies of the source file with different extensions:" << std::endl;
     std::cout << "- .traditional: using traditional copy method" << std::endl;
     std::cout << "- .mmap: using mmap/munmap method" << std::endl;
+    std::cout << "- .mmap_window: using sliding-window mmap method" << std::endl;
 #if defined(__linux__) || defined(__APPLE__)
     std::cout << "- .sendfile: using sendfile method" << std::endl;
 #endif
 #ifdef __linux__
-    std::cout << "- .splice: using splice method" << std::endl;
+    std::cout << "- .splice: using splice method with pooled, enlarged pipes" << std::endl;
+    std::cout << "- .copy_file_range: using copy_file_range method" << std::endl;
+    std::cout << "- .io_uring: using io_uring method" << std::endl;
 #endif
+    std::cout << "- .parallel: using parallel chunked copy" << std::endl;
+    std::cout << "- .direct_io: using O_DIRECT copy" << std::endl;
+    std::cout << "- .sparse: using hole-preserving copy" << std::endl;
+    std::cout << "- .verified_*: using checksummed copy" << std::endl;
+    std::cout << "\nBenchmark options:" << std::endl;
+    std::cout << "  --sizes <list>      file sizes to generate, e.g. 1M,64M,1G (default 1M,64M,256M)" << std::endl;
+    std::cout << "  --files <n>         files per size, each run copies all of them (default 1)" << std::endl;
+    std::cout << "  --profile <name>    generated data: random, zeros, text, sparse or repeated (default random)" << std::endl;
+    std::cout << "  --buffers <list>    buffer sizes for buffered methods (default 4K,64K,1M)" << std::endl;
+    std::cout << "  --windows <list>    window sizes for mmap_window (default 64M,256M)" << std::endl;
+    std::cout << "  --methods <list>    methods to run, e.g. mmap,splice (default all)" << std::endl;
+    std::cout << "  --warmup <n>        warmup runs per case (default 1)" << std::endl;
+    std::cout << "  --reps <n>          measured runs per case (default 5)" << std::endl;
+    std::cout << "  --dir <path>        directory for generated files (default .)" << std::endl;
+    std::cout << "  --format <fmt>      text, json or csv (default text)" << std::endl;
+    std::cout << "  --output <file>     write the report to a file instead of stdout" << std::endl;
+    std::cout << "  --no-evict          keep the page cache warm between runs" << std::endl;
+}
+
+// 解析带K/M/G后缀的大小，如"64M"
+uint64_t parse_size(const std::string& text) {
+    size_t pos = 0;
+    uint64_t value = std::stoull(text, &pos);
+    if (pos < text.size()) {
+        switch (text[pos]) {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default:
+            throw std::invalid_argument("invalid size suffix: " + text);
+        }
+    }
+    return value;
+}
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int run_benchmark_mode(int argc, char* argv[]) {
+    zero_copy::BenchmarkOptions options;
+    zero_copy::ReportFormat format = zero_copy::ReportFormat::Text;
+    std::string output_path;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--no-evict") {
+            options.evict_cache = false;
+        } else if (!has_value) {
+            std::cerr << "Error: missing value for " << arg << std::endl;
+            return 1;
+        } else if (arg == "--sizes") {
+            options.file_sizes.clear();
+            for (const auto& item : split_list(argv[++i])) {
+                options.file_sizes.push_back(parse_size(item));
+            }
+        } else if (arg == "--files") {
+            options.file_count = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--profile") {
+            std::string name = argv[++i];
+            if (!zero_copy::parse_data_profile(name, options.data_profile)) {
+                std::cerr << "Error: unknown profile " << name << std::endl;
+                return 1;
+            }
+        } else if (arg == "--buffers") {
+            options.buffer_sizes.clear();
+            for (const auto& item : split_list(argv[++i])) {
+                options.buffer_sizes.push_back(static_cast<size_t>(parse_size(item)));
+            }
+        } else if (arg == "--windows") {
+            options.window_sizes.clear();
+            for (const auto& item : split_list(argv[++i])) {
+                options.window_sizes.push_back(static_cast<size_t>(parse_size(item)));
+            }
+        } else if (arg == "--methods") {
+            options.methods = split_list(argv[++i]);
+        } else if (arg == "--warmup") {
+            options.warmup_runs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--reps") {
+            options.repetitions = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--dir") {
+            options.work_dir = argv[++i];
+        } else if (arg == "--format") {
+            std::string value = argv[++i];
+            if (value == "text") {
+                format = zero_copy::ReportFormat::Text;
+            } else if (value == "json") {
+                format = zero_copy::ReportFormat::Json;
+            } else if (value == "csv") {
+                format = zero_copy::ReportFormat::Csv;
+            } else {
+                std::cerr << "Error: unknown format " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--output") {
+            output_path = argv[++i];
+        } else {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.repetitions == 0) {
+        std::cerr << "Error: --reps must be greater than 0" << std::endl;
+        return 1;
+    }
+
+    auto results = zero_copy::run_benchmark(options);
+
+    if (output_path.empty()) {
+        zero_copy::write_results(results, format, std::cout);
+    } else {
+        std::ofstream out(output_path);
+        if (!out) {
+            std::cerr << "Error: could not open " << output_path << " for writing" << std::endl;
+            return 1;
+        }
+        zero_copy::write_results(results, format, out);
+    }
+    return 0;
 }
 
 bool file_exists(const std::string& path) {
     return access(path.c_str(), F_OK) != -1;
 }
 
+// 单独执行稀疏文件复制并报告跳过的字节数
+int run_sparse_mode(const std::string& src_path, const std::string& dst_path) {
+    zero_copy::SparseCopyStats stats;
+    if (!zero_copy::sparse_copy(src_path, dst_path, &stats)) {
+        return 1;
+    }
+    std::cout << "File size: " << stats.file_size << " bytes" << std::endl;
+    if (stats.cloned) {
+        std::cout << "Cloned with FICLONE (copy-on-write), no data copied" << std::endl;
+    } else {
+        std::cout << "Data extents: " << stats.data_extents << std::endl;
+        std::cout << "Bytes copied: " << stats.bytes_copied << std::endl;
+    }
+    std::cout << "Bytes skipped: " << stats.bytes_skipped << std::endl;
+    std::cout << "Elapsed: " << stats.elapsed.count() << " microseconds" << std::endl;
+    if (!stats.cloned) {
+        std::cout << "Estimated time saved: " << stats.estimated_time_saved.count() << " microseconds" << std::endl;
+    }
+    return 0;
+}
+
+// 增量复制，只重写目标文件中变化的块
+int run_delta_mode(const std::string& src_path, const std::string& dst_path, const std::string& block_size_text) {
+    size_t block_size = 1024 * 1024;
+    if (!block_size_text.empty()) {
+        try {
+            block_size = static_cast<size_t>(parse_size(block_size_text));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: invalid block size " << block_size_text << std::endl;
+            return 1;
+        }
+    }
+
+    zero_copy::DeltaCopyStats stats;
+    if (!zero_copy::delta_copy(src_path, dst_path, &stats, block_size)) {
+        return 1;
+    }
+    std::cout << "File size: " << stats.file_size << " bytes" << std::endl;
+    if (!stats.destination_existed) {
+        std::cout << "Destination did not exist, all blocks written" << std::endl;
+    }
+    std::cout << "Blocks changed: " << stats.blocks_changed << " of " << stats.blocks_total << std::endl;
+    std::cout << "Bytes written: " << stats.bytes_written << std::endl;
+    std::cout << "Bytes skipped: " << stats.bytes_skipped << std::endl;
+    std::cout << "Elapsed: " << stats.elapsed.count() << " microseconds" << std::endl;
+    return 0;
+}
+
+int run_tree_mode(const std::string& src_dir, const std::string& dst_dir, const std::string& threads_text) {
+    zero_copy::TreeCopyOptions options;
+    if (!threads_text.empty()) {
+        try {
+            options.threads = static_cast<unsigned>(std::stoul(threads_text));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: invalid thread count " << threads_text << std::endl;
+            return 1;
+        }
+    }
+
+    zero_copy::TreeCopyStats stats;
+    bool ok = zero_copy::tree_copy(src_dir, dst_dir, options, &stats);
+    std::cout << "Directories: " << stats.directories << std::endl;
+    std::cout << "Small files: " << stats.small_files << std::endl;
+    std::cout << "Large files: " << stats.large_files << std::endl;
+    std::cout << "Symlinks: " << stats.symlinks << std::endl;
+    std::cout << "Skipped: " << stats.skipped << std::endl;
+    std::cout << "Errors: " << stats.errors << std::endl;
+    std::cout << "Bytes copied: " << stats.bytes_copied << std::endl;
+    std::cout << "Elapsed: " << stats.elapsed.count() << " microseconds" << std::endl;
+    return ok ? 0 : 1;
+}
+
+int run_auto_mode(const std::string& src_path, const std::string& dst_path, bool recalibrate) {
+    zero_copy::AutoCopyOptions options;
+    options.recalibrate = recalibrate;
+    zero_copy::AutoCopyResult result;
+    bool ok = false;
+    auto elapsed = zero_copy::measure_time([&]() { ok = zero_copy::auto_copy(src_path, dst_path, options, &result); });
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Method: " << zero_copy::auto_copy_method_name(result.method)
+              << (result.calibrated ? " (calibrated, " : " (from calibration table, ")
+              << result.mb_per_s << " MB/s)" << std::endl;
+    std::cout << "Elapsed: " << elapsed.count() << " microseconds" << std::endl;
+    return 0;
+}
+
+int run_paced_mode(const std::string& src_path, const std::string& dst_path, int argc, char* argv[]) {
+    zero_copy::PacedCopyOptions options;
+    try {
+        if (argc > 4) {
+            options.readahead_window = parse_size(argv[4]);
+        }
+        if (argc > 5) {
+            options.writeback_window = parse_size(argv[5]);
+        }
+        if (argc > 6) {
+            options.dirty_limit = parse_size(argv[6]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: invalid window size" << std::endl;
+        return 1;
+    }
+
+    zero_copy::PacedCopyStats stats;
+    if (!zero_copy::paced_copy(src_path, dst_path, options, &stats)) {
+        return 1;
+    }
+    std::cout << "Bytes copied: " << stats.bytes_copied << std::endl;
+    std::cout << "Readahead calls: " << stats.readahead_calls << std::endl;
+    std::cout << "Writeback calls: " << stats.writeback_calls << std::endl;
+    std::cout << "Throttle waits: " << stats.throttle_waits << " (" << stats.throttle_time.count() << " microseconds)" << std::endl;
+    std::cout << "Write latency (smoothed): " << stats.write_latency_us << " microseconds" << std::endl;
+    std::cout << "Write latency (max): " << stats.max_write_latency_us << " microseconds" << std::endl;
+    std::cout << "Elapsed: " << stats.elapsed.count() << " microseconds" << std::endl;
+    return 0;
+}
+
+void print_compression_stats(const zero_copy::CompressionStats& stats) {
+    std::cout << "Original size: " << stats.original_bytes << " bytes" << std::endl;
+    std::cout << "Compressed size: " << stats.compressed_bytes << " bytes";
+    if (stats.original_bytes > 0) {
+        std::cout << " (" << (stats.compressed_bytes * 100.0 / stats.original_bytes) << "%)";
+    }
+    std::cout << std::endl;
+    std::cout << "Chunks: " << stats.chunks << " (" << stats.stored_chunks << " stored uncompressed)" << std::endl;
+    std::cout << "Elapsed: " << stats.elapsed.count() << " microseconds" << std::endl;
+}
+
+// 分块并行压缩复制
+int run_compress_mode(const std::string& src_path, const std::string& dst_path, const std::string& codec_name) {
+    zero_copy::CompressionOptions options;
+    if (!codec_name.empty()) {
+        if (codec_name == "zstd") {
+            options.codec = zero_copy::CompressionCodec::Zstd;
+        } else if (codec_name == "lz4") {
+            options.codec = zero_copy::CompressionCodec::Lz4;
+        } else if (codec_name == "stored") {
+            options.codec = zero_copy::CompressionCodec::Stored;
+        } else {
+            std::cerr << "Error: unknown codec " << codec_name << std::endl;
+            return 1;
+        }
+    }
+
+    zero_copy::CompressionStats stats;
+    if (!zero_copy::compress_copy(src_path, dst_path, options, &stats)) {
+        return 1;
+    }
+    std::cout << "Codec: " << zero_copy::compression_codec_name(options.codec) << std::endl;
+    print_compression_stats(stats);
+    return 0;
+}
+
+int run_decompress_mode(const std::string& src_path, const std::string& dst_path) {
+    zero_copy::CompressionStats stats;
+    if (!zero_copy::decompress_copy(src_path, dst_path, 0, &stats)) {
+        return 1;
+    }
+    print_compression_stats(stats);
+    return 0;
+}
+
+// 带校验的复制，并与重新读取目标文件得到的校验和比较
+int run_verify_mode(const std::string& src_path, const std::string& dst_path, const std::string& method_name) {
+    zero_copy::VerifiedCopyMethod method;
+    if (method_name == "buffered") {
+        method = zero_copy::VerifiedCopyMethod::Buffered;
+    } else if (method_name == "mmap") {
+        method = zero_copy::VerifiedCopyMethod::Mmap;
+    } else if (method_name == "splice") {
+        method = zero_copy::VerifiedCopyMethod::Splice;
+    } else {
+        std::cerr << "Error: unknown verified copy method " << method_name << std::endl;
+        return 1;
+    }
+
+    zero_copy::VerifiedCopyResult result;
+    auto elapsed = zero_copy::measure_time([&]() {
+        return zero_copy::verified_copy(src_path, dst_path, method, &result, true);
+    });
+    std::cout << "CRC32C (" << (zero_copy::crc32c_hardware_accelerated() ? "SSE4.2" : "software")
+              << "): source " << std::hex << result.source_crc
+              << ", destination " << result.destination_crc << std::dec << std::endl;
+    std::cout << "Elapsed: " << elapsed.count() << " microseconds" << std::endl;
+    if (!result.destination_checked || !result.match) {
+        std::cerr << "Verification failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Verification succeeded" << std::endl;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--benchmark") == 0) {
+        try {
+            return run_benchmark_mode(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--sparse") == 0) {
+        return run_sparse_mode(argv[2], argv[3]);
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--delta") == 0) {
+        return run_delta_mode(argv[2], argv[3], argc == 5 ? argv[4] : "");
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--tree") == 0) {
+        return run_tree_mode(argv[2], argv[3], argc == 5 ? argv[4] : "");
+    }
+
+    if ((argc == 4 || (argc == 5 && strcmp(argv[4], "--recalibrate") == 0)) && strcmp(argv[1], "--auto") == 0) {
+        return run_auto_mode(argv[2], argv[3], argc == 5);
+    }
+
+    if (argc >= 4 && argc <= 7 && strcmp(argv[1], "--paced") == 0) {
+        return run_paced_mode(argv[2], argv[3], argc, argv);
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--compress") == 0) {
+        return run_compress_mode(argv[2], argv[3], argc == 5 ? argv[4] : "");
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--decompress") == 0) {
+        return run_decompress_mode(argv[2], argv[3]);
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--verify") == 0) {
+        return run_verify_mode(argv[2], argv[3], argc == 5 ? argv[4] : "mmap");
+    }
+
     if (argc != 3) {
         print_usage(argv[0]);
         return 1;
@@ -46,14 +440,7 @@ int main(int argc, char* argv[]) {
 
     // 检查目标文件是否已存在
     if (file_exists(dst_path)) {
-        std::cout << "Warning: Destination file '" << dst_path << "' already exists and will be overwritten." << std::endl;
-        std::cout << "Do you want to continue? (y/n): ";
-        char response;
-        std::cin >> response;
-        if (response != 'y' && response != 'Y') {
-            std::cout << "Operation cancelled by user." << std::endl;
-            return 0;
-        }
+        std::cerr << "Warning: Destination file '" << dst_path << "' already exists and will be overwritten." << std::endl;
     }
 
     try {
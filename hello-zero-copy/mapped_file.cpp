@@ -0,0 +1,178 @@
+#include "mapped_file.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+// 透明大页的大小，启用大页时窗口按它对齐
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+int madvise_advice(AccessHint hint) {
+    switch (hint) {
+    case AccessHint::Sequential:
+        return MADV_SEQUENTIAL;
+    case AccessHint::Random:
+        return MADV_RANDOM;
+    case AccessHint::WillNeed:
+        return MADV_WILLNEED;
+    case AccessHint::Normal:
+        break;
+    }
+    return MADV_NORMAL;
+}
+
+} // namespace
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        size_ = std::exchange(other.size_, 0);
+        options_ = other.options_;
+        window_size_ = std::exchange(other.window_size_, 0);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        window_offset_ = std::exchange(other.window_offset_, 0);
+        mapped_length_ = std::exchange(other.mapped_length_, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path, const MappedFileOptions& options) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error opening file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    off_t size = get_file_size(fd);
+    if (size == -1) {
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    size_ = static_cast<uint64_t>(size);
+    options_ = options;
+
+    // 窗口起点必须按页对齐；启用大页时按2MB对齐
+    size_t alignment = options.huge_pages ? kHugePageSize : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (options.window_size == 0 || options.window_size >= size_) {
+        window_size_ = static_cast<size_t>(size_);
+    } else {
+        window_size_ = (std::max(options.window_size, alignment) + alignment - 1) / alignment * alignment;
+    }
+
+    // 空文件不能映射，视图始终为空
+    if (size_ > 0 && !map_window(0)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    unmap();
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+    window_size_ = 0;
+}
+
+void MappedFile::unmap() {
+    if (mapping_) {
+        munmap(mapping_, mapped_length_);
+        mapping_ = nullptr;
+    }
+    window_offset_ = 0;
+    mapped_length_ = 0;
+}
+
+bool MappedFile::map_window(uint64_t offset) {
+    unmap();
+    uint64_t start = offset / window_size_ * window_size_;
+    size_t length = static_cast<size_t>(std::min<uint64_t>(window_size_, size_ - start));
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (options_.populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* addr = mmap(NULL, length, PROT_READ, flags, fd_, static_cast<off_t>(start));
+    if (addr == MAP_FAILED) {
+        std::cerr << "Error mapping file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    mapping_ = addr;
+    window_offset_ = start;
+    mapped_length_ = length;
+
+    if (options_.hint != AccessHint::Normal) {
+        madvise(mapping_, mapped_length_, madvise_advice(options_.hint));
+    }
+#ifdef MADV_HUGEPAGE
+    if (options_.huge_pages) {
+        madvise(mapping_, mapped_length_, MADV_HUGEPAGE);
+    }
+#endif
+    return true;
+}
+
+ByteSpan MappedFile::data() const {
+    if (!fully_mapped()) {
+        return ByteSpan();
+    }
+    return ByteSpan(static_cast<const std::byte*>(mapping_), mapped_length_);
+}
+
+ByteSpan MappedFile::view(uint64_t offset, size_t length) {
+    if (!is_open() || offset >= size_) {
+        return ByteSpan();
+    }
+    if (!mapping_ || offset < window_offset_ || offset >= window_offset_ + mapped_length_) {
+        if (!map_window(offset)) {
+            return ByteSpan();
+        }
+    }
+    size_t in_window = static_cast<size_t>(offset - window_offset_);
+    return ByteSpan(static_cast<const std::byte*>(mapping_), mapped_length_).subspan(in_window, length);
+}
+
+void MappedFile::advise(uint64_t offset, size_t length, AccessHint hint) {
+    if (!mapping_) {
+        return;
+    }
+    // 与当前窗口求交集，起点向下对齐到页
+    uint64_t begin = std::max(offset, window_offset_);
+    uint64_t end = std::min(offset + length, window_offset_ + mapped_length_);
+    if (begin >= end) {
+        return;
+    }
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t relative = static_cast<size_t>(begin - window_offset_) / page * page;
+    madvise(static_cast<char*>(mapping_) + relative,
+            static_cast<size_t>(end - window_offset_) - relative, madvise_advice(hint));
+}
+
+} // namespace zero_copy
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 只读字节视图，相当于C++20的std::span<const std::byte>
+class ByteSpan {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    ByteSpan() = default;
+    ByteSpan(const std::byte* data, size_t size) : data_(data), size_(size) {}
+
+    const std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const std::byte* begin() const { return data_; }
+    const std::byte* end() const { return data_ + size_; }
+    const std::byte& operator[](size_t index) const { return data_[index]; }
+
+    // offset超出范围时返回空视图
+    ByteSpan subspan(size_t offset, size_t count = npos) const {
+        if (offset >= size_) {
+            return ByteSpan();
+        }
+        size_t available = size_ - offset;
+        return ByteSpan(data_ + offset, count < available ? count : available);
+    }
+
+private:
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 对映射区域的访问提示，对应madvise
+enum class AccessHint {
+    Normal,
+    Sequential,     // 顺序访问，内核加大预读并尽早回收已读过的页
+    Random,         // 随机访问，关闭预读
+    WillNeed        // 立即开始异步预读
+};
+
+struct MappedFileOptions {
+    AccessHint hint = AccessHint::Normal;
+    bool populate = false;      // MAP_POPULATE：映射时预先建立页表并读入数据
+    bool huge_pages = false;    // madvise(MADV_HUGEPAGE)，需要文件系统支持透明大页
+    // 同一时刻最多映射的字节数（地址空间预算），0表示映射整个文件；
+    // 文件大于该值时由view()按需重新映射窗口
+    size_t window_size = 0;
+};
+
+// 文件的只读内存映射，拥有文件描述符和映射，只能移动不能复制
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开并映射文件，失败时输出错误并返回false
+    bool open(const std::string& path, const MappedFileOptions& options = MappedFileOptions());
+    void close();
+
+    bool is_open() const { return fd_ != -1; }
+    uint64_t size() const { return size_; }
+    int fd() const { return fd_; }
+
+    // 整个文件是否同时处于映射中（window_size为0或文件不大于窗口）
+    bool fully_mapped() const { return is_open() && window_offset_ == 0 && mapped_length_ == size_; }
+
+    // 整个文件的视图，只在fully_mapped()时有效，否则返回空视图
+    ByteSpan data() const;
+
+    // 从offset开始至多length字节的视图
+    // 不在当前窗口内时重新映射窗口，此前由view()返回的视图随之失效；
+    // 视图不会跨越窗口边界，所以可能比length短，调用方需要循环读取。映射失败时返回空视图。
+    ByteSpan view(uint64_t offset, size_t length);
+
+    // 对文件的一个区间给出访问提示，只作用于当前已映射的部分
+    void advise(uint64_t offset, size_t length, AccessHint hint);
+
+private:
+    bool map_window(uint64_t offset);
+    void unmap();
+
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    MappedFileOptions options_;
+    size_t window_size_ = 0;        // 按对齐要求取整后的窗口大小
+    void* mapping_ = nullptr;
+    uint64_t window_offset_ = 0;    // 当前映射在文件中的起始位置
+    size_t mapped_length_ = 0;
+};
+
+} // namespace zero_copy
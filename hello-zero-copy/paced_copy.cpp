@@ -0,0 +1,192 @@
+#include "paced_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+void start_readahead(int fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    readahead(fd, static_cast<off_t>(offset), static_cast<size_t>(length));
+#elif defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#endif
+}
+
+// 只提交回写，不等待完成
+void start_writeback(int fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+#else
+    (void)fd;
+    (void)offset;
+    (void)length;
+#endif
+}
+
+// 等待区间内已提交的回写完成，没有sync_file_range时退化为fdatasync
+void wait_writeback(int fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(length),
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+    (void)offset;
+    (void)length;
+    fdatasync(fd);
+#endif
+}
+
+void drop_cached(int fd, uint64_t offset, uint64_t length) {
+#if defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+    (void)fd;
+    (void)offset;
+    (void)length;
+#endif
+}
+
+} // namespace
+
+bool paced_copy(const std::string& src_path, const std::string& dst_path,
+                const PacedCopyOptions& options, PacedCopyStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(src_size);
+
+    // 回写批次至少一个块，脏页上限至少容纳两个批次，保证回写和写入能够重叠
+    size_t chunk_size = std::max<size_t>(options.chunk_size, 4096);
+    uint64_t writeback_window = std::max<uint64_t>(options.writeback_window, chunk_size);
+    uint64_t dirty_limit = std::max(options.dirty_limit, 2 * writeback_window);
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    PacedCopyStats local;
+    std::vector<char> buffer(chunk_size);
+    std::deque<uint64_t> pending;       // 已提交回写但还没有等待过的批次的结束位置
+    uint64_t offset = 0;
+    uint64_t readahead_end = 0;
+    uint64_t flushed = 0;               // 已提交回写的位置
+    uint64_t synced = 0;                // 已确认落盘的位置
+    bool success = true;
+
+    while (offset < size) {
+        // 剩余的预读距离不足一半时一次补齐，避免每个块都调用一次readahead
+        if (options.readahead_window > 0 && readahead_end < size &&
+            readahead_end < offset + options.readahead_window / 2) {
+            uint64_t begin = std::max(readahead_end, offset);
+            readahead_end = std::min(size, offset + options.readahead_window);
+            start_readahead(src_fd, begin, readahead_end - begin);
+            ++local.readahead_calls;
+        }
+
+        ssize_t bytes_read = read(src_fd, buffer.data(), static_cast<size_t>(std::min<uint64_t>(chunk_size, size - offset)));
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading from source file: " << strerror(errno) << std::endl;
+            success = false;
+            break;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+
+        auto write_start = std::chrono::steady_clock::now();
+        ssize_t done = 0;
+        while (done < bytes_read) {
+            ssize_t bytes_written = write(dst_fd, buffer.data() + done, bytes_read - done);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error writing to destination file: " << strerror(errno) << std::endl;
+                success = false;
+                break;
+            }
+            done += bytes_written;
+        }
+        if (!success) {
+            break;
+        }
+        double latency_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - write_start).count();
+        local.write_latency_us = local.write_latency_us == 0 ? latency_us : local.write_latency_us + (latency_us - local.write_latency_us) / 8;
+        local.max_write_latency_us = std::max(local.max_write_latency_us, latency_us);
+        offset += bytes_read;
+
+        if (offset - flushed >= writeback_window) {
+            start_writeback(dst_fd, flushed, offset - flushed);
+            pending.push_back(offset);
+            flushed = offset;
+            ++local.writeback_calls;
+        }
+
+        // 超过脏页上限时从最早的批次开始等待，直到重新回到上限以内
+        if (offset - synced > dirty_limit && !pending.empty()) {
+            auto wait_start = std::chrono::steady_clock::now();
+            while (offset - synced > dirty_limit && !pending.empty()) {
+                uint64_t end = pending.front();
+                pending.pop_front();
+                wait_writeback(dst_fd, synced, end - synced);
+                if (options.drop_behind) {
+                    drop_cached(dst_fd, synced, end - synced);
+                    drop_cached(src_fd, synced, end - synced);
+                }
+                synced = end;
+            }
+            ++local.throttle_waits;
+            local.throttle_time += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - wait_start);
+        }
+    }
+
+    // 尾部也只提交回写，不在这里等待
+    if (success && offset > flushed) {
+        start_writeback(dst_fd, flushed, offset - flushed);
+        ++local.writeback_calls;
+    }
+
+    close(src_fd);
+    if (close(dst_fd) == -1 && success) {
+        std::cerr << "Error closing destination file: " << strerror(errno) << std::endl;
+        success = false;
+    }
+
+    local.bytes_copied = offset;
+    local.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    if (stats) {
+        *stats = local;
+    }
+    return success;
+}
+
+} // namespace zero_copy
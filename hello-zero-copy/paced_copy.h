@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+struct PacedCopyOptions {
+    size_t chunk_size = 1024 * 1024;                // 每次read/write的字节数
+    uint64_t readahead_window = 16ull << 20;        // 在读游标之前保持的预读距离
+    uint64_t writeback_window = 8ull << 20;         // 每积累这么多新写入的数据就发起一次异步回写
+    uint64_t dirty_limit = 64ull << 20;             // 已写入但还未确认落盘的字节数上限
+    bool drop_behind = true;                        // 确认落盘的区间从页缓存中丢弃
+};
+
+struct PacedCopyStats {
+    uint64_t bytes_copied = 0;
+    uint64_t readahead_calls = 0;
+    uint64_t writeback_calls = 0;           // SYNC_FILE_RANGE_WRITE异步回写的次数
+    uint64_t throttle_waits = 0;            // 因达到dirty_limit而等待回写完成的次数
+    std::chrono::microseconds throttle_time{0};
+    double write_latency_us = 0;            // write调用耗时的指数平滑值（权重1/8）
+    double max_write_latency_us = 0;
+    std::chrono::microseconds elapsed{0};
+};
+
+// 显式调度预读和回写的顺序复制
+// 读游标之前始终保持readahead_window字节的预读（readahead，非Linux上为POSIX_FADV_WILLNEED），
+// 写游标之后每writeback_window字节用sync_file_range(SYNC_FILE_RANGE_WRITE)发起异步回写，
+// 未确认落盘的数据超过dirty_limit时等待最早的回写完成，避免脏页在close时集中写回。
+bool paced_copy(const std::string& src_path, const std::string& dst_path,
+                const PacedCopyOptions& options = PacedCopyOptions(), PacedCopyStats* stats = nullptr);
+
+} // namespace zero_copy
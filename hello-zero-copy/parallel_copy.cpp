@@ -0,0 +1,295 @@
+#include "parallel_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace zero_copy {
+
+const char* range_copy_method_name(RangeCopyMethod method) {
+    switch (method) {
+    case RangeCopyMethod::PreadPwrite:
+        return "pread/pwrite";
+    case RangeCopyMethod::Sendfile:
+        return "sendfile";
+    case RangeCopyMethod::CopyFileRange:
+        return "copy_file_range";
+    }
+    return "unknown";
+}
+
+namespace {
+
+// 所有工作线程共享的状态
+struct ParallelCopyState {
+    off_t file_size = 0;
+    size_t chunk_size = 0;
+    RangeCopyMethod method = RangeCopyMethod::PreadPwrite;
+    std::atomic<off_t> next_chunk{0};
+    std::atomic<bool> abort{false};
+    std::mutex error_mutex;
+    std::string error;
+
+    // 记录第一个错误并通知其他线程停止
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error.empty()) {
+            error = message;
+        }
+        abort.store(true, std::memory_order_relaxed);
+    }
+};
+
+// 每次系统调用最多复制的字节数，保证出错时其他线程能及时看到abort标志
+const size_t kMaxStep = 8 * 1024 * 1024;
+
+bool copy_range_pread_pwrite(int src_fd, int dst_fd, off_t offset, size_t length,
+                             std::vector<char>& buffer, ParallelCopyState& state) {
+    while (length > 0 && !state.abort.load(std::memory_order_relaxed)) {
+        size_t to_read = std::min(length, buffer.size());
+        ssize_t bytes_read = pread(src_fd, buffer.data(), to_read, offset);
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            state.fail(std::string("Error reading from source file: ") + strerror(errno));
+            return false;
+        }
+        if (bytes_read == 0) {
+            state.fail("Error: source file was truncated during copy");
+            return false;
+        }
+
+        ssize_t done = 0;
+        while (done < bytes_read) {
+            ssize_t bytes_written = pwrite(dst_fd, buffer.data() + done, bytes_read - done, offset + done);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                state.fail(std::string("Error writing to destination file: ") + strerror(errno));
+                return false;
+            }
+            done += bytes_written;
+        }
+        offset += bytes_read;
+        length -= bytes_read;
+    }
+    return !state.abort.load(std::memory_order_relaxed);
+}
+
+#ifdef __linux__
+// sendfile写入的是目标fd的当前位置，因此每个线程使用自己的目标fd并先定位
+bool copy_range_sendfile(int src_fd, int dst_fd, off_t offset, size_t length,
+                         ParallelCopyState& state) {
+    if (lseek(dst_fd, offset, SEEK_SET) == -1) {
+        state.fail(std::string("Error seeking destination file: ") + strerror(errno));
+        return false;
+    }
+    while (length > 0 && !state.abort.load(std::memory_order_relaxed)) {
+        ssize_t bytes_sent = sendfile(dst_fd, src_fd, &offset, std::min(length, kMaxStep));
+        if (bytes_sent == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            state.fail(std::string("Error during sendfile: ") + strerror(errno));
+            return false;
+        }
+        if (bytes_sent == 0) {
+            state.fail("Error: source file was truncated during copy");
+            return false;
+        }
+        length -= bytes_sent;
+    }
+    return !state.abort.load(std::memory_order_relaxed);
+}
+
+// 返回false且errno为ENOSYS/EXDEV等时由调用方回退到pread/pwrite
+bool copy_range_copy_file_range(int src_fd, int dst_fd, off_t offset, size_t length,
+                                ParallelCopyState& state, bool& unsupported) {
+    off_t offset_in = offset;
+    off_t offset_out = offset;
+    while (length > 0 && !state.abort.load(std::memory_order_relaxed)) {
+        ssize_t bytes_copied = copy_file_range(src_fd, &offset_in, dst_fd, &offset_out,
+                                               std::min(length, kMaxStep), 0);
+        if (bytes_copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (offset_in == offset && (errno == ENOSYS || errno == EXDEV ||
+                                        errno == EOPNOTSUPP || errno == EINVAL)) {
+                unsupported = true;
+                return false;
+            }
+            state.fail(std::string("Error during copy_file_range: ") + strerror(errno));
+            return false;
+        }
+        if (bytes_copied == 0) {
+            state.fail("Error: source file was truncated during copy");
+            return false;
+        }
+        length -= bytes_copied;
+    }
+    return !state.abort.load(std::memory_order_relaxed);
+}
+#endif
+
+void copy_worker(const std::string& src_path, const std::string& dst_path, ParallelCopyState& state) {
+    // 每个线程独立打开文件，避免共享文件偏移量和f_pos锁
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        state.fail(std::string("Error opening source file: ") + strerror(errno));
+        return;
+    }
+    int dst_fd = open(dst_path.c_str(), O_WRONLY);
+    if (dst_fd == -1) {
+        state.fail(std::string("Error opening destination file: ") + strerror(errno));
+        close(src_fd);
+        return;
+    }
+
+    RangeCopyMethod method = state.method;
+    std::vector<char> buffer;
+    if (method == RangeCopyMethod::PreadPwrite) {
+        buffer.resize(std::min(state.chunk_size, static_cast<size_t>(1024 * 1024)));
+    }
+
+    while (!state.abort.load(std::memory_order_relaxed)) {
+        off_t chunk = state.next_chunk.fetch_add(1, std::memory_order_relaxed);
+        off_t offset = chunk * static_cast<off_t>(state.chunk_size);
+        if (offset >= state.file_size) {
+            break;
+        }
+        size_t length = static_cast<size_t>(std::min<off_t>(state.chunk_size, state.file_size - offset));
+
+        bool ok = false;
+#ifdef __linux__
+        if (method == RangeCopyMethod::CopyFileRange) {
+            bool unsupported = false;
+            ok = copy_range_copy_file_range(src_fd, dst_fd, offset, length, state, unsupported);
+            if (unsupported) {
+                method = RangeCopyMethod::PreadPwrite;
+            }
+        } else if (method == RangeCopyMethod::Sendfile) {
+            ok = copy_range_sendfile(src_fd, dst_fd, offset, length, state);
+        }
+#endif
+        if (method == RangeCopyMethod::PreadPwrite) {
+            if (buffer.empty()) {
+                buffer.resize(std::min(state.chunk_size, static_cast<size_t>(1024 * 1024)));
+            }
+            ok = copy_range_pread_pwrite(src_fd, dst_fd, offset, length, buffer, state);
+        }
+        if (!ok) {
+            break;
+        }
+    }
+
+    close(src_fd);
+    close(dst_fd);
+}
+
+} // namespace
+
+// 并行分块复制大文件
+bool parallel_copy(const std::string& src_path, const std::string& dst_path,
+                   unsigned threads, size_t chunk_size, RangeCopyMethod method) {
+    if (chunk_size == 0) {
+        std::cerr << "Error: chunk size must be greater than 0" << std::endl;
+        return false;
+    }
+#ifndef __linux__
+    if (method != RangeCopyMethod::PreadPwrite) {
+        std::cerr << range_copy_method_name(method)
+                  << " is only available on Linux systems, using pread/pwrite" << std::endl;
+        method = RangeCopyMethod::PreadPwrite;
+    }
+#endif
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    off_t src_size = get_file_size(src_fd);
+    close(src_fd);
+    if (src_size == -1) {
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // 预分配目标文件，避免并发写入时的碎片和反复扩展元数据
+    if (src_size > 0) {
+        bool allocated = false;
+#ifdef __linux__
+        allocated = fallocate(dst_fd, 0, 0, src_size) == 0;
+        if (!allocated && errno != EOPNOTSUPP && errno != ENOSYS) {
+            std::cerr << "Error preallocating destination file: " << strerror(errno) << std::endl;
+            close(dst_fd);
+            unlink(dst_path.c_str());
+            return false;
+        }
+#endif
+        // 文件系统不支持fallocate时至少设置好文件大小
+        if (!allocated && ftruncate(dst_fd, src_size) == -1) {
+            std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
+            close(dst_fd);
+            unlink(dst_path.c_str());
+            return false;
+        }
+    }
+    close(dst_fd);
+
+    ParallelCopyState state;
+    state.file_size = src_size;
+    state.chunk_size = chunk_size;
+    state.method = method;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    off_t chunk_count = (src_size + static_cast<off_t>(chunk_size) - 1) / static_cast<off_t>(chunk_size);
+    threads = static_cast<unsigned>(std::max<off_t>(1, std::min<off_t>(threads, chunk_count)));
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    try {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back(copy_worker, std::cref(src_path), std::cref(dst_path), std::ref(state));
+        }
+    } catch (const std::system_error& e) {
+        state.fail(std::string("Error starting copy thread: ") + e.what());
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (state.abort.load()) {
+        std::cerr << state.error << std::endl;
+        // 不保留不完整的目标文件
+        unlink(dst_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace zero_copy
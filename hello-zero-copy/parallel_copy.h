@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace zero_copy {
+
+// 并行复制中每个区间使用的复制方式
+enum class RangeCopyMethod {
+    PreadPwrite,    // 经过用户空间缓冲区的pread/pwrite
+    Sendfile,       // 带显式偏移量的sendfile
+    CopyFileRange   // 内核内的copy_file_range，不支持时回退到pread/pwrite
+};
+
+const char* range_copy_method_name(RangeCopyMethod method);
+
+// 并行分块复制大文件
+// 先用fallocate为目标文件预分配空间，再把文件切成chunk_size大小的区间，
+// 由threads个工作线程并发复制。threads为0时使用硬件并发数。
+// 任一线程出错都会让其余线程尽快停止，并删除不完整的目标文件。
+bool parallel_copy(const std::string& src_path, const std::string& dst_path,
+                   unsigned threads = 0, size_t chunk_size = 64 * 1024 * 1024,
+                   RangeCopyMethod method = RangeCopyMethod::CopyFileRange);
+
+} // namespace zero_copy
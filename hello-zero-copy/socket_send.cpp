@@ -0,0 +1,329 @@
+#include "socket_send.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/epoll.h>
+#endif
+
+namespace zero_copy {
+
+const char* socket_send_method_name(SocketSendMethod method) {
+    switch (method) {
+    case SocketSendMethod::Sendfile:
+        return "sendfile";
+    case SocketSendMethod::Splice:
+        return "splice";
+    case SocketSendMethod::ReadSend:
+        return "read+send";
+    }
+    return "unknown";
+}
+
+namespace {
+
+// 每次系统调用最多传输的字节数
+const size_t kSendChunk = 1024 * 1024;
+
+// 非阻塞socket遇到EAGAIN时等待其再次可写
+class WritableWaiter {
+public:
+    explicit WritableWaiter(int sock) : sock_(sock) {}
+
+    ~WritableWaiter() {
+        if (epoll_fd_ != -1) {
+            close(epoll_fd_);
+        }
+    }
+
+    WritableWaiter(const WritableWaiter&) = delete;
+    WritableWaiter& operator=(const WritableWaiter&) = delete;
+
+    bool wait(SocketSendStats& stats) {
+        ++stats.eagain_waits;
+#ifdef __linux__
+        // 只有真正遇到EAGAIN时才创建epoll实例，阻塞socket不会产生额外开销
+        if (epoll_fd_ == -1) {
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd_ == -1) {
+                return false;
+            }
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLOUT;
+            ev.data.fd = sock_;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sock_, &ev) == -1) {
+                return false;
+            }
+        }
+        for (;;) {
+            struct epoll_event ev;
+            int n = epoll_wait(epoll_fd_, &ev, 1, -1);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n == -1) {
+                return false;
+            }
+            return (ev.events & (EPOLLERR | EPOLLHUP)) == 0;
+        }
+#else
+        for (;;) {
+            struct pollfd pfd;
+            pfd.fd = sock_;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            int n = poll(&pfd, 1, -1);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            return n == 1 && (pfd.revents & (POLLERR | POLLHUP)) == 0;
+        }
+#endif
+    }
+
+private:
+    int sock_;
+    int epoll_fd_ = -1;
+};
+
+// TCP_CORK在作用域内阻止发送不完整的报文段；非TCP socket上静默忽略
+class TcpCork {
+public:
+    explicit TcpCork(int sock) : sock_(sock) {
+#ifdef TCP_CORK
+        int on = 1;
+        corked_ = setsockopt(sock_, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)) == 0;
+#endif
+    }
+
+    ~TcpCork() {
+#ifdef TCP_CORK
+        if (corked_) {
+            int off = 0;
+            setsockopt(sock_, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+        }
+#endif
+    }
+
+    TcpCork(const TcpCork&) = delete;
+    TcpCork& operator=(const TcpCork&) = delete;
+
+private:
+    int sock_;
+    bool corked_ = false;
+};
+
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+#ifdef MSG_MORE
+const int kMoreFlag = MSG_MORE;
+#else
+const int kMoreFlag = 0;
+#endif
+
+bool send_all(int sock, const char* data, size_t length, int flags,
+              WritableWaiter& waiter, SocketSendStats& stats) {
+    while (length > 0) {
+        ssize_t sent = send(sock, data, length, flags | kSendFlags);
+        ++stats.syscalls;
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && waiter.wait(stats)) {
+                continue;
+            }
+            std::cerr << "Error sending to socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+bool send_with_read(int file_fd, int sock, off_t offset, size_t length,
+                    WritableWaiter& waiter, SocketSendStats& stats) {
+    std::vector<char> buffer(std::min(length, kSendChunk));
+    while (length > 0) {
+        ssize_t bytes_read = pread(file_fd, buffer.data(), std::min(length, buffer.size()), offset);
+        ++stats.syscalls;
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading from file: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (bytes_read == 0) {
+            std::cerr << "Error: file is shorter than the requested range" << std::endl;
+            return false;
+        }
+        if (!send_all(sock, buffer.data(), bytes_read, 0, waiter, stats)) {
+            return false;
+        }
+        offset += bytes_read;
+        length -= bytes_read;
+        stats.bytes_sent += bytes_read;
+    }
+    return true;
+}
+
+#ifdef __linux__
+bool send_with_sendfile(int file_fd, int sock, off_t offset, size_t length,
+                        WritableWaiter& waiter, SocketSendStats& stats) {
+    while (length > 0) {
+        ssize_t sent = sendfile(sock, file_fd, &offset, std::min(length, kSendChunk));
+        ++stats.syscalls;
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN && waiter.wait(stats)) {
+                continue;
+            }
+            std::cerr << "Error during sendfile: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (sent == 0) {
+            std::cerr << "Error: file is shorter than the requested range" << std::endl;
+            return false;
+        }
+        length -= sent;
+        stats.bytes_sent += sent;
+    }
+    return true;
+}
+
+bool send_with_splice(int file_fd, int sock, off_t offset, size_t length,
+                      WritableWaiter& waiter, SocketSendStats& stats) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == -1) {
+        std::cerr << "Error creating pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool success = true;
+    while (length > 0 && success) {
+        ssize_t in_pipe = splice(file_fd, &offset, pipe_fds[1], NULL, std::min(length, kSendChunk),
+                                 SPLICE_F_MOVE | SPLICE_F_MORE);
+        ++stats.syscalls;
+        if (in_pipe == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error splicing from file to pipe: " << strerror(errno) << std::endl;
+            success = false;
+            break;
+        }
+        if (in_pipe == 0) {
+            std::cerr << "Error: file is shorter than the requested range" << std::endl;
+            success = false;
+            break;
+        }
+
+        // 管道中的数据必须全部送进socket，后面的数据才能继续进入管道
+        ssize_t drained = 0;
+        while (drained < in_pipe) {
+            unsigned flags = SPLICE_F_MOVE;
+            if (length > static_cast<size_t>(in_pipe)) {
+                flags |= SPLICE_F_MORE;
+            }
+            ssize_t out = splice(pipe_fds[0], NULL, sock, NULL, in_pipe - drained, flags);
+            ++stats.syscalls;
+            if (out == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN && waiter.wait(stats)) {
+                    continue;
+                }
+                std::cerr << "Error splicing from pipe to socket: " << strerror(errno) << std::endl;
+                success = false;
+                break;
+            }
+            drained += out;
+        }
+        length -= in_pipe;
+        stats.bytes_sent += in_pipe;
+    }
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return success;
+}
+#endif
+
+} // namespace
+
+bool send_file_to_socket(int file_fd, int sock, off_t offset, size_t length,
+                         SocketSendMethod method, const std::string& header,
+                         SocketSendStats* stats) {
+    SocketSendStats local_stats;
+    SocketSendStats& st = stats ? *stats : local_stats;
+
+    if (length == 0) {
+        off_t file_size = get_file_size(file_fd);
+        if (file_size == -1) {
+            return false;
+        }
+        if (offset > file_size) {
+            std::cerr << "Error: offset is beyond the end of file" << std::endl;
+            return false;
+        }
+        length = static_cast<size_t>(file_size - offset);
+    }
+
+    WritableWaiter waiter(sock);
+    // 头部和文件数据之间不产生小报文段
+    TcpCork cork(sock);
+
+    if (!header.empty() &&
+        !send_all(sock, header.data(), header.size(), length > 0 ? kMoreFlag : 0, waiter, st)) {
+        return false;
+    }
+
+#ifdef __linux__
+    if (method == SocketSendMethod::Sendfile) {
+        return send_with_sendfile(file_fd, sock, offset, length, waiter, st);
+    }
+    if (method == SocketSendMethod::Splice) {
+        return send_with_splice(file_fd, sock, offset, length, waiter, st);
+    }
+#else
+    (void)method;
+#endif
+    return send_with_read(file_fd, sock, offset, length, waiter, st);
+}
+
+bool send_file_to_socket(const std::string& path, int sock, off_t offset, size_t length,
+                         SocketSendMethod method, const std::string& header,
+                         SocketSendStats* stats) {
+    int file_fd = open(path.c_str(), O_RDONLY);
+    if (file_fd == -1) {
+        std::cerr << "Error opening file: " << strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = send_file_to_socket(file_fd, sock, offset, length, method, header, stats);
+    close(file_fd);
+    return ok;
+}
+
+} // namespace zero_copy
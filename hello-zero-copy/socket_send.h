@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace zero_copy {
+
+// 文件发送到socket时使用的方法
+enum class SocketSendMethod {
+    Sendfile,   // sendfile直接从页缓存发送
+    Splice,     // 文件 -> 管道 -> socket
+    ReadSend    // 传统的pread + send，用于对比
+};
+
+const char* socket_send_method_name(SocketSendMethod method);
+
+// 发送过程的统计信息
+struct SocketSendStats {
+    uint64_t bytes_sent = 0;    // 不含头部的文件数据字节数
+    uint64_t syscalls = 0;      // 数据传输相关的系统调用次数
+    uint64_t eagain_waits = 0;  // 非阻塞socket上等待epoll可写的次数
+};
+
+// 把文件的[offset, offset + length)发送到socket，length为0表示一直发送到文件末尾
+// header非空时先在TCP_CORK下用MSG_MORE发送头部，使头部和文件数据合并成完整的报文段。
+// socket可以是阻塞或非阻塞的；非阻塞时遇到EAGAIN会用epoll等待可写。
+bool send_file_to_socket(int file_fd, int sock, off_t offset, size_t length,
+                         SocketSendMethod method = SocketSendMethod::Sendfile,
+                         const std::string& header = std::string(),
+                         SocketSendStats* stats = nullptr);
+
+bool send_file_to_socket(const std::string& path, int sock, off_t offset, size_t length,
+                         SocketSendMethod method = SocketSendMethod::Sendfile,
+                         const std::string& header = std::string(),
+                         SocketSendStats* stats = nullptr);
+
+} // namespace zero_copy
@@ -0,0 +1,217 @@
+// 本地回环上的文件发送基准测试
+// 在同一进程内启动一个接收端线程，比较sendfile、splice与read+send的吞吐量和每GB的CPU开销
+
+#include "socket_send.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace {
+
+// 当前线程消耗的CPU时间（用户态 + 内核态），单位秒
+double thread_cpu_seconds() {
+    struct rusage usage;
+#ifdef RUSAGE_THREAD
+    if (getrusage(RUSAGE_THREAD, &usage) == -1) {
+        return 0;
+    }
+#else
+    if (getrusage(RUSAGE_SELF, &usage) == -1) {
+        return 0;
+    }
+#endif
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// 监听127.0.0.1上的随机端口，返回监听socket并写出端口号
+int listen_loopback(unsigned short& port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        listen(sock, 1) == -1 ||
+        getsockname(sock, reinterpret_cast<struct sockaddr*>(&addr), &len) == -1) {
+        close(sock);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return sock;
+}
+
+int connect_loopback(unsigned short port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+struct RunResult {
+    bool ok = false;
+    double seconds = 0;
+    double sender_cpu = 0;
+    double receiver_cpu = 0;
+    uint64_t bytes = 0;
+    zero_copy::SocketSendStats stats;
+};
+
+RunResult run_once(const std::string& path, zero_copy::SocketSendMethod method,
+                   unsigned repetitions, bool nonblocking) {
+    RunResult result;
+
+    unsigned short port = 0;
+    int listen_fd = listen_loopback(port);
+    if (listen_fd == -1) {
+        std::cerr << "Error creating loopback listener: " << strerror(errno) << std::endl;
+        return result;
+    }
+
+    // 接收端：读出并丢弃所有数据
+    uint64_t received = 0;
+    double receiver_cpu = 0;
+    std::thread sink([&]() {
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn == -1) {
+            return;
+        }
+        double cpu_start = thread_cpu_seconds();
+        std::vector<char> buffer(1024 * 1024);
+        for (;;) {
+            ssize_t n = recv(conn, buffer.data(), buffer.size(), 0);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            received += n;
+        }
+        receiver_cpu = thread_cpu_seconds() - cpu_start;
+        close(conn);
+    });
+
+    int sock = connect_loopback(port);
+    if (sock == -1) {
+        std::cerr << "Error connecting to loopback listener: " << strerror(errno) << std::endl;
+        shutdown(listen_fd, SHUT_RDWR);
+        close(listen_fd);
+        sink.join();
+        return result;
+    }
+    if (nonblocking) {
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+    }
+
+    int file_fd = open(path.c_str(), O_RDONLY);
+    if (file_fd == -1) {
+        std::cerr << "Error opening file: " << strerror(errno) << std::endl;
+        close(sock);
+        close(listen_fd);
+        sink.join();
+        return result;
+    }
+
+    double cpu_start = thread_cpu_seconds();
+    auto start = std::chrono::steady_clock::now();
+    result.ok = true;
+    for (unsigned i = 0; i < repetitions && result.ok; ++i) {
+        result.ok = zero_copy::send_file_to_socket(file_fd, sock, 0, 0, method, "", &result.stats);
+    }
+    shutdown(sock, SHUT_WR);
+    sink.join();
+    auto end = std::chrono::steady_clock::now();
+    result.sender_cpu = thread_cpu_seconds() - cpu_start;
+
+    close(file_fd);
+    close(sock);
+    close(listen_fd);
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.receiver_cpu = receiver_cpu;
+    result.bytes = received;
+    if (received != result.stats.bytes_sent) {
+        std::cerr << "Error: sink received " << received << " bytes, expected "
+                  << result.stats.bytes_sent << std::endl;
+        result.ok = false;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <file> [repetitions] [--nonblocking]" << std::endl;
+        std::cout << "Sends the file over a loopback TCP connection with each method and reports" << std::endl;
+        std::cout << "throughput and sender/receiver CPU seconds per GB." << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+    unsigned repetitions = 10;
+    bool nonblocking = false;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--nonblocking") == 0) {
+            nonblocking = true;
+        } else {
+            repetitions = static_cast<unsigned>(std::stoul(argv[i]));
+        }
+    }
+
+    // 接收端提前关闭时不因SIGPIPE退出
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << std::left << std::setw(12) << "method"
+              << std::right << std::setw(12) << "MB/s"
+              << std::setw(16) << "send CPU s/GB"
+              << std::setw(16) << "recv CPU s/GB"
+              << std::setw(14) << "syscalls"
+              << std::setw(12) << "EAGAIN" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    for (auto method : {zero_copy::SocketSendMethod::ReadSend,
+                        zero_copy::SocketSendMethod::Sendfile,
+                        zero_copy::SocketSendMethod::Splice}) {
+        RunResult r = run_once(path, method, repetitions, nonblocking);
+        std::cout << std::left << std::setw(12) << zero_copy::socket_send_method_name(method) << std::right;
+        if (!r.ok || r.bytes == 0) {
+            std::cout << std::setw(12) << "failed" << std::endl;
+            continue;
+        }
+        double gb = r.bytes / (1024.0 * 1024.0 * 1024.0);
+        std::cout << std::setw(12) << (r.bytes / (1024.0 * 1024.0)) / r.seconds
+                  << std::setw(16) << r.sender_cpu / gb
+                  << std::setw(16) << r.receiver_cpu / gb
+                  << std::setw(14) << r.stats.syscalls
+                  << std::setw(12) << r.stats.eagain_waits << std::endl;
+    }
+    return 0;
+}
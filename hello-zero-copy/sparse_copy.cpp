@@ -0,0 +1,191 @@
+#include "sparse_copy.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace zero_copy {
+
+namespace {
+
+// 复制一个数据区间，优先使用copy_file_range，不支持时退回pread/pwrite
+bool copy_data_range(int src_fd, int dst_fd, off_t offset, off_t length,
+                     bool& use_copy_file_range, std::vector<char>& buffer) {
+    off_t end = offset + length;
+#ifdef __linux__
+    while (use_copy_file_range && offset < end) {
+        off_t offset_in = offset;
+        off_t offset_out = offset;
+        ssize_t bytes_copied = copy_file_range(src_fd, &offset_in, dst_fd, &offset_out, end - offset, 0);
+        if (bytes_copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL) {
+                use_copy_file_range = false;
+                break;
+            }
+            std::cerr << "Error during copy_file_range: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (bytes_copied == 0) {
+            return true; // 源文件被截断
+        }
+        offset += bytes_copied;
+    }
+#else
+    use_copy_file_range = false;
+#endif
+
+    if (offset < end && buffer.empty()) {
+        buffer.resize(1024 * 1024);
+    }
+    while (offset < end) {
+        size_t to_read = static_cast<size_t>(std::min<off_t>(buffer.size(), end - offset));
+        ssize_t bytes_read = pread(src_fd, buffer.data(), to_read, offset);
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading from source file: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (bytes_read == 0) {
+            return true;
+        }
+        ssize_t done = 0;
+        while (done < bytes_read) {
+            ssize_t bytes_written = pwrite(dst_fd, buffer.data() + done, bytes_read - done, offset + done);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error writing to destination file: " << strerror(errno) << std::endl;
+                return false;
+            }
+            done += bytes_written;
+        }
+        offset += bytes_read;
+    }
+    return true;
+}
+
+} // namespace
+
+bool sparse_copy(const std::string& src_path, const std::string& dst_path,
+                 SparseCopyStats* stats, bool try_clone) {
+    SparseCopyStats local_stats;
+    SparseCopyStats& st = stats ? *stats : local_stats;
+    st = SparseCopyStats();
+    auto start = std::chrono::steady_clock::now();
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+    st.file_size = static_cast<uint64_t>(src_size);
+
+#ifdef FICLONE
+    // 写时复制克隆：不复制任何数据，只共享数据块
+    if (try_clone && ioctl(dst_fd, FICLONE, src_fd) == 0) {
+        st.cloned = true;
+        st.bytes_skipped = st.file_size;
+        st.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        close(src_fd);
+        close(dst_fd);
+        return true;
+    }
+#else
+    (void)try_clone;
+#endif
+
+    bool use_copy_file_range = true;
+    std::vector<char> buffer;
+    bool success = true;
+    std::chrono::microseconds data_time{0};
+
+    off_t offset = 0;
+    while (offset < src_size) {
+        off_t data_start = offset;
+        off_t data_end = src_size;
+#ifdef SEEK_DATA
+        data_start = lseek(src_fd, offset, SEEK_DATA);
+        if (data_start == -1) {
+            if (errno == ENXIO) {
+                break; // 剩余部分全是空洞
+            }
+            if (errno != EINVAL) {
+                std::cerr << "Error seeking data in source file: " << strerror(errno) << std::endl;
+                success = false;
+                break;
+            }
+            // 不支持SEEK_DATA时把剩余部分当作一个数据区间
+            data_start = offset;
+        } else {
+            data_end = lseek(src_fd, data_start, SEEK_HOLE);
+            if (data_end == -1) {
+                data_end = src_size;
+            }
+        }
+#endif
+        data_end = std::min(data_end, src_size);
+
+        auto range_start = std::chrono::steady_clock::now();
+        if (!copy_data_range(src_fd, dst_fd, data_start, data_end - data_start, use_copy_file_range, buffer)) {
+            success = false;
+            break;
+        }
+        data_time += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - range_start);
+
+        st.bytes_copied += static_cast<uint64_t>(data_end - data_start);
+        ++st.data_extents;
+        offset = data_end;
+    }
+
+    // 末尾的空洞只需要设置文件大小
+    if (success && ftruncate(dst_fd, src_size) == -1) {
+        std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
+        success = false;
+    }
+
+    st.bytes_skipped = st.file_size - std::min(st.file_size, st.bytes_copied);
+    if (st.bytes_copied > 0) {
+        st.estimated_time_saved = std::chrono::microseconds(static_cast<long long>(
+            static_cast<double>(data_time.count()) * st.bytes_skipped / st.bytes_copied));
+    }
+    st.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    close(src_fd);
+    close(dst_fd);
+    return success;
+}
+
+} // namespace zero_copy
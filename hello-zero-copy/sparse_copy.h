@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 稀疏文件复制的统计信息
+struct SparseCopyStats {
+    uint64_t file_size = 0;
+    uint64_t bytes_copied = 0;          // 实际复制的数据字节数
+    uint64_t bytes_skipped = 0;         // 作为空洞保留或通过克隆共享的字节数
+    uint64_t data_extents = 0;          // 复制的数据区间个数
+    bool cloned = false;                // 是否通过FICLONE完成了写时复制克隆
+    std::chrono::microseconds elapsed{0};
+    // 按实际数据区间的复制速度估算，跳过的字节本来需要的时间
+    std::chrono::microseconds estimated_time_saved{0};
+};
+
+// 保留空洞的文件复制方法
+// 优先尝试ioctl(FICLONE)做写时复制克隆；文件系统不支持时用SEEK_DATA/SEEK_HOLE
+// 遍历源文件的数据区间，只复制数据部分，目标文件中的空洞保持为空洞。
+bool sparse_copy(const std::string& src_path, const std::string& dst_path,
+                 SparseCopyStats* stats = nullptr, bool try_clone = true);
+
+} // namespace zero_copy
@@ -0,0 +1,258 @@
+#include "splice_engine.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+// 管道的默认容量（16个页）
+const size_t kDefaultPipeSize = 64 * 1024;
+// 每个线程最多缓存的空闲管道数
+const size_t kMaxPooledPipes = 4;
+
+struct Pipe {
+    int read_fd = -1;
+    int write_fd = -1;
+    size_t capacity = 0;
+    // 上次调整容量时请求的大小；请求被配额限制时capacity会小于它，
+    // 复用时请求没变就不再重复注定失败的F_SETPIPE_SZ
+    size_t requested = 0;
+};
+
+void close_pipe(Pipe& pipe) {
+    if (pipe.read_fd != -1) {
+        close(pipe.read_fd);
+    }
+    if (pipe.write_fd != -1) {
+        close(pipe.write_fd);
+    }
+    pipe = Pipe();
+}
+
+#ifdef __linux__
+// 把管道容量调整为desired；超出pipe-user-pages-soft等配额时返回EPERM，
+// 此时逐步减半直到成功
+size_t resize_pipe(int fd, size_t desired) {
+    for (size_t size = desired; size >= kDefaultPipeSize; size /= 2) {
+        int result = fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+        if (result > 0) {
+            return static_cast<size_t>(result);
+        }
+        if (errno != EPERM && errno != ENOMEM) {
+            break;
+        }
+    }
+    int current = fcntl(fd, F_GETPIPE_SZ);
+    return current > 0 ? static_cast<size_t>(current) : kDefaultPipeSize;
+}
+#endif
+
+// 线程局部的空闲管道池，线程退出时关闭所有管道
+class PipePool {
+public:
+    ~PipePool() {
+        for (auto& pipe : pipes_) {
+            close_pipe(pipe);
+        }
+    }
+
+    bool take(Pipe& pipe) {
+        if (pipes_.empty()) {
+            return false;
+        }
+        pipe = pipes_.back();
+        pipes_.pop_back();
+        return true;
+    }
+
+    void give_back(Pipe& pipe) {
+        if (pipes_.size() < kMaxPooledPipes) {
+            pipes_.push_back(pipe);
+            pipe = Pipe();
+        } else {
+            close_pipe(pipe);
+        }
+    }
+
+private:
+    std::vector<Pipe> pipes_;
+};
+
+PipePool& local_pipe_pool() {
+    thread_local PipePool pool;
+    return pool;
+}
+
+// 在一次复制期间独占一个管道；管道中残留数据时不能放回池中
+class PipeLease {
+public:
+    explicit PipeLease(bool pooled) : pooled_(pooled) {}
+    ~PipeLease() {
+        if (pipe_.read_fd == -1) {
+            return;
+        }
+        if (pooled_ && clean_) {
+            local_pipe_pool().give_back(pipe_);
+        } else {
+            close_pipe(pipe_);
+        }
+    }
+    PipeLease(const PipeLease&) = delete;
+    PipeLease& operator=(const PipeLease&) = delete;
+
+    // 获取一个容量为desired的管道，新建管道时created为true
+    bool acquire(size_t desired, bool& created) {
+        created = false;
+        if (!pooled_ || !local_pipe_pool().take(pipe_)) {
+            int fds[2];
+            if (pipe(fds) == -1) {
+                std::cerr << "Error creating pipe: " << strerror(errno) << std::endl;
+                return false;
+            }
+            pipe_.read_fd = fds[0];
+            pipe_.write_fd = fds[1];
+            pipe_.capacity = kDefaultPipeSize;
+            pipe_.requested = kDefaultPipeSize;
+            created = true;
+        }
+#ifdef __linux__
+        if (pipe_.requested != desired) {
+            pipe_.capacity = resize_pipe(pipe_.write_fd, desired);
+            pipe_.requested = desired;
+        }
+#endif
+        return true;
+    }
+
+    const Pipe& get() const { return pipe_; }
+    void mark_dirty() { clean_ = false; }
+
+private:
+    Pipe pipe_;
+    bool pooled_;
+    bool clean_ = true;
+};
+
+} // namespace
+
+SpliceEngine::SpliceEngine(const SpliceEngineOptions& options)
+    : options_(options) {
+}
+
+size_t SpliceEngine::max_pipe_size() {
+    static const size_t max_size = []() {
+        size_t size = 0;
+        std::ifstream limit("/proc/sys/fs/pipe-max-size");
+        if (!(limit >> size) || size < kDefaultPipeSize) {
+            size = 1024 * 1024;
+        }
+        return size;
+    }();
+    return max_size;
+}
+
+bool SpliceEngine::copy_fd(int src_fd, int dst_fd, off_t length) {
+#ifdef __linux__
+    PipeLease lease(options_.reuse_pipes);
+    bool created = false;
+    size_t desired = options_.pipe_size > 0 ? options_.pipe_size : max_pipe_size();
+    if (!lease.acquire(desired, created)) {
+        return false;
+    }
+    if (created) {
+        ++stats_.pipes_created;
+    }
+    const Pipe& pipe = lease.get();
+    // 一次搬运的数据量与管道容量相同，小文件只需要两次splice
+    const size_t chunk_size = pipe.capacity;
+
+    off_t remaining = length;
+    while (remaining > 0) {
+        size_t to_copy = static_cast<size_t>(std::min<off_t>(remaining, chunk_size));
+        ssize_t bytes_spliced = splice(src_fd, NULL, pipe.write_fd, NULL, to_copy, SPLICE_F_MOVE);
+        ++stats_.splice_calls;
+        if (bytes_spliced == -1 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
+        }
+        if (bytes_spliced <= 0) {
+            if (bytes_spliced == 0) {
+                std::cerr << "Error: source file was truncated during copy" << std::endl;
+            } else {
+                std::cerr << "Error splicing from source to pipe: " << strerror(errno) << std::endl;
+            }
+            return false;
+        }
+
+        ssize_t bytes_written = 0;
+        while (bytes_written < bytes_spliced) {
+            ssize_t res = splice(pipe.read_fd, NULL, dst_fd, NULL, bytes_spliced - bytes_written, SPLICE_F_MOVE);
+            ++stats_.splice_calls;
+            if (res == -1 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            if (res <= 0) {
+                std::cerr << "Error splicing from pipe to destination: " << strerror(errno) << std::endl;
+                lease.mark_dirty();
+                return false;
+            }
+            bytes_written += res;
+        }
+        remaining -= bytes_spliced;
+        stats_.bytes_copied += bytes_spliced;
+    }
+    return true;
+#else
+    (void)src_fd;
+    (void)dst_fd;
+    (void)length;
+    std::cerr << "splice is only available on Linux systems" << std::endl;
+    return false;
+#endif
+}
+
+bool SpliceEngine::copy(const std::string& src_path, const std::string& dst_path) {
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    bool success = src_size != -1 && copy_fd(src_fd, dst_fd, src_size);
+
+    close(src_fd);
+    close(dst_fd);
+    if (success) {
+        ++stats_.files_copied;
+    }
+    return success;
+}
+
+size_t SpliceEngine::copy_batch(const std::vector<std::pair<std::string, std::string>>& files) {
+    size_t copied = 0;
+    for (const auto& file : files) {
+        if (copy(file.first, file.second)) {
+            ++copied;
+        } else {
+            std::cerr << "Failed to copy " << file.first << " to " << file.second << std::endl;
+        }
+    }
+    return copied;
+}
+
+} // namespace zero_copy
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace zero_copy {
+
+struct SpliceEngineOptions {
+    // 期望的管道容量，0表示使用/proc/sys/fs/pipe-max-size；
+    // 超出用户管道配额时会逐步减半，实际值以内核返回为准
+    size_t pipe_size = 0;
+    // 从线程局部的管道池中复用管道；为false时每次复制都新建并关闭管道
+    bool reuse_pipes = true;
+};
+
+struct SpliceStats {
+    uint64_t bytes_copied = 0;
+    uint64_t files_copied = 0;
+    uint64_t splice_calls = 0;
+    uint64_t pipes_created = 0;     // 池中没有可用管道时新建的次数
+};
+
+// 可复用的splice复制引擎
+// 管道保存在线程局部的池中，同一线程上的多次复制（包括不同的引擎对象）共用管道，
+// 每块数据的大小等于管道的实际容量，使每次splice搬运尽可能多的数据
+class SpliceEngine {
+public:
+    explicit SpliceEngine(const SpliceEngineOptions& options = SpliceEngineOptions());
+
+    bool copy(const std::string& src_path, const std::string& dst_path);
+
+    // 从两个文件描述符的当前位置开始复制length字节
+    bool copy_fd(int src_fd, int dst_fd, off_t length);
+
+    // 依次复制多个文件，复用管道时全部通过同一个管道完成，返回成功复制的文件数
+    // 某个文件失败时输出错误并继续复制其余文件
+    size_t copy_batch(const std::vector<std::pair<std::string, std::string>>& files);
+
+    const SpliceStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = SpliceStats(); }
+
+    // 系统允许的最大管道容量（/proc/sys/fs/pipe-max-size），无法读取时为1MB
+    static size_t max_pipe_size();
+
+private:
+    SpliceEngineOptions options_;
+    SpliceStats stats_;
+};
+
+} // namespace zero_copy
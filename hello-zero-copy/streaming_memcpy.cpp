@@ -0,0 +1,133 @@
+#include "streaming_memcpy.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZERO_COPY_HAVE_X86_STREAMING 1
+#endif
+
+namespace zero_copy {
+
+namespace {
+
+// 预取源数据的提前量，大约是几十个缓存行，足以覆盖内存延迟
+const size_t kPrefetchDistance = 512;
+
+#ifdef ZERO_COPY_HAVE_X86_STREAMING
+// 先用memcpy复制到目标地址按align对齐，返回已复制的字节数
+inline size_t copy_head(unsigned char*& d, const unsigned char*& s, size_t length, size_t align) {
+    size_t head = (align - (reinterpret_cast<uintptr_t>(d) & (align - 1))) & (align - 1);
+    head = head < length ? head : length;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    return head;
+}
+
+__attribute__((target("avx2")))
+void streaming_memcpy_avx2(void* dst, const void* src, size_t length) {
+    unsigned char* d = static_cast<unsigned char*>(dst);
+    const unsigned char* s = static_cast<const unsigned char*>(src);
+    length -= copy_head(d, s, length, 32);
+
+    // 每次迭代处理两个缓存行；源地址不一定对齐，使用非对齐加载
+    while (length >= 128) {
+        _mm_prefetch(reinterpret_cast<const char*>(s + kPrefetchDistance), _MM_HINT_NTA);
+        _mm_prefetch(reinterpret_cast<const char*>(s + kPrefetchDistance + 64), _MM_HINT_NTA);
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 64));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 96), e);
+        s += 128;
+        d += 128;
+        length -= 128;
+    }
+    // 非临时存储是弱序的，必须在返回前用sfence使其对其他线程和后续的msync可见
+    _mm_sfence();
+    memcpy(d, s, length);
+}
+
+__attribute__((target("sse2")))
+void streaming_memcpy_sse2(void* dst, const void* src, size_t length) {
+    unsigned char* d = static_cast<unsigned char*>(dst);
+    const unsigned char* s = static_cast<const unsigned char*>(src);
+    length -= copy_head(d, s, length, 16);
+
+    while (length >= 64) {
+        _mm_prefetch(reinterpret_cast<const char*>(s + kPrefetchDistance), _MM_HINT_NTA);
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+        s += 64;
+        d += 64;
+        length -= 64;
+    }
+    _mm_sfence();
+    memcpy(d, s, length);
+}
+#endif
+
+enum class Kernel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+Kernel select_kernel() {
+#ifdef ZERO_COPY_HAVE_X86_STREAMING
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Kernel::Sse2;
+    }
+#endif
+    return Kernel::Scalar;
+}
+
+Kernel active_kernel() {
+    static const Kernel kernel = select_kernel();
+    return kernel;
+}
+
+} // namespace
+
+void streaming_memcpy(void* dst, const void* src, size_t length) {
+    switch (active_kernel()) {
+#ifdef ZERO_COPY_HAVE_X86_STREAMING
+    case Kernel::Avx2:
+        streaming_memcpy_avx2(dst, src, length);
+        return;
+    case Kernel::Sse2:
+        streaming_memcpy_sse2(dst, src, length);
+        return;
+#endif
+    default:
+        memcpy(dst, src, length);
+        return;
+    }
+}
+
+const char* streaming_memcpy_kernel() {
+    switch (active_kernel()) {
+    case Kernel::Avx2:
+        return "avx2";
+    case Kernel::Sse2:
+        return "sse2";
+    case Kernel::Scalar:
+        return "scalar";
+    }
+    return "scalar";
+}
+
+} // namespace zero_copy
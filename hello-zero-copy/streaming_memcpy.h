@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+namespace zero_copy {
+
+// 复制量超过该值时mmap复制改用非临时存储，避免整个文件流经CPU缓存
+// 把同一主机上其他服务的工作集挤出LLC
+const size_t kStreamingCopyThreshold = 8 * 1024 * 1024;
+
+// 使用非临时存储（绕过缓存直接写内存）的memcpy
+// x86上运行时检测AVX2/SSE2，使用_mm256_stream_si256/_mm_stream_si128并配合软件预取，
+// 结束时执行sfence；其他平台退回普通memcpy。
+void streaming_memcpy(void* dst, const void* src, size_t length);
+
+// 当前使用的实现："avx2"、"sse2"或"scalar"
+const char* streaming_memcpy_kernel();
+
+// 按大小选择：不小于threshold时使用streaming_memcpy，否则使用memcpy
+inline void copy_memory(void* dst, const void* src, size_t length,
+                        size_t threshold = kStreamingCopyThreshold) {
+    if (length >= threshold) {
+        streaming_memcpy(dst, src, length);
+    } else {
+        memcpy(dst, src, length);
+    }
+}
+
+} // namespace zero_copy
@@ -0,0 +1,286 @@
+#include "test_data.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+const char* data_profile_name(DataProfile profile) {
+    switch (profile) {
+    case DataProfile::Random:
+        return "random";
+    case DataProfile::Zeros:
+        return "zeros";
+    case DataProfile::Text:
+        return "text";
+    case DataProfile::Sparse:
+        return "sparse";
+    case DataProfile::Repeated:
+        return "repeated";
+    }
+    return "unknown";
+}
+
+bool parse_data_profile(const std::string& name, DataProfile& profile) {
+    for (auto candidate : {DataProfile::Random, DataProfile::Zeros, DataProfile::Text,
+                           DataProfile::Sparse, DataProfile::Repeated}) {
+        if (name == data_profile_name(candidate)) {
+            profile = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+
+// 每个工作线程一次生成和写入的字节数
+const size_t kChunkSize = 4 * 1024 * 1024;
+// Sparse中决定数据或空洞的区段大小
+const size_t kSparseExtent = 1024 * 1024;
+
+__extension__ typedef unsigned __int128 uint128;
+
+// wyrand的混合函数：第i个随机数只依赖seed和i，
+// 循环中没有跨迭代的状态依赖，编译器可以展开和向量化
+inline uint64_t wymix(uint64_t a, uint64_t b) {
+    uint128 r = static_cast<uint128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t wyrand_at(uint64_t seed, uint64_t index) {
+    uint64_t state = seed + (index + 1) * 0xa0761d6478bd642full;
+    return wymix(state, state ^ 0xe7037ed1a0b428dbull);
+}
+
+// 用文件中的字编号作为计数器，使内容与分块方式和线程数无关
+void fill_random(char* data, size_t length, uint64_t seed, uint64_t file_offset) {
+    uint64_t first_word = file_offset / sizeof(uint64_t);
+    size_t words = length / sizeof(uint64_t);
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t value = wyrand_at(seed, first_word + i);
+        memcpy(data + i * sizeof(uint64_t), &value, sizeof(value));
+    }
+    size_t tail = length - words * sizeof(uint64_t);
+    if (tail > 0) {
+        uint64_t value = wyrand_at(seed, first_word + words);
+        memcpy(data + words * sizeof(uint64_t), &value, tail);
+    }
+}
+
+const char* const kWords[] = {
+    "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on", "not",
+    "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they", "you", "were",
+    "their", "one", "all", "we", "can", "her", "has", "there", "been", "if", "more", "when", "will", "would",
+    "who", "so", "no", "file", "copy", "kernel", "page", "cache", "buffer", "socket", "memory", "disk", "data",
+    "zero", "read", "write", "system", "call", "thread",
+};
+const size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+// 每个分块从行首开始，用分块偏移作为种子，保证结果可复现
+void fill_text(char* data, size_t length, uint64_t seed, uint64_t file_offset) {
+    uint64_t index = 0;
+    size_t pos = 0;
+    unsigned words_in_line = 0;
+    while (pos < length) {
+        uint64_t r = wyrand_at(seed ^ file_offset, index++);
+        const char* word = kWords[r % kWordCount];
+        size_t word_length = strlen(word);
+        size_t n = std::min(word_length, length - pos);
+        memcpy(data + pos, word, n);
+        pos += n;
+        if (pos < length) {
+            // 每行至少8个单词，之后每个单词后有1/8的概率换行
+            bool end_line = ++words_in_line >= 8 && (r >> 32) % 8 == 0;
+            data[pos++] = end_line ? '\n' : ' ';
+            if (end_line) {
+                words_in_line = 0;
+            }
+        }
+    }
+}
+
+bool sparse_extent_has_data(uint64_t seed, uint64_t extent, unsigned data_percent) {
+    return wyrand_at(seed ^ 0x5350415253455ull, extent) % 100 < data_percent;
+}
+
+bool write_all_at(int fd, const char* data, size_t length, off_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+    return true;
+}
+
+// 所有工作线程共享的状态
+struct GeneratorState {
+    const TestDataOptions* options = nullptr;
+    uint64_t size = 0;
+    std::vector<char> repeated_block;
+    std::atomic<uint64_t> next_chunk{0};
+    std::atomic<bool> abort{false};
+    std::mutex mutex;
+    uint64_t bytes_done = 0;
+    std::string error;
+
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty()) {
+            error = message;
+        }
+        abort.store(true, std::memory_order_relaxed);
+    }
+
+    void report(uint64_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes_done += bytes;
+        if (options->on_progress) {
+            options->on_progress(bytes_done, size);
+        }
+    }
+};
+
+void generate_worker(int fd, GeneratorState& state) {
+    const TestDataOptions& options = *state.options;
+    std::vector<char> buffer(kChunkSize);
+
+    while (!state.abort.load(std::memory_order_relaxed)) {
+        uint64_t offset = state.next_chunk.fetch_add(1, std::memory_order_relaxed) * kChunkSize;
+        if (offset >= state.size) {
+            break;
+        }
+        size_t length = static_cast<size_t>(std::min<uint64_t>(kChunkSize, state.size - offset));
+        char* data = buffer.data();
+        bool ok = true;
+
+        switch (options.profile) {
+        case DataProfile::Random:
+            fill_random(data, length, options.seed, offset);
+            ok = write_all_at(fd, data, length, offset);
+            break;
+        case DataProfile::Zeros:
+            memset(data, 0, length);
+            ok = write_all_at(fd, data, length, offset);
+            break;
+        case DataProfile::Text:
+            fill_text(data, length, options.seed, offset);
+            ok = write_all_at(fd, data, length, offset);
+            break;
+        case DataProfile::Sparse:
+            // 只写入数据区段，其余部分保持为空洞
+            for (size_t done = 0; done < length && ok; done += kSparseExtent) {
+                uint64_t extent_offset = offset + done;
+                size_t extent_length = std::min(kSparseExtent, length - done);
+                if (sparse_extent_has_data(options.seed, extent_offset / kSparseExtent,
+                                           options.sparse_data_percent)) {
+                    fill_random(data, extent_length, options.seed, extent_offset);
+                    ok = write_all_at(fd, data, extent_length, extent_offset);
+                }
+            }
+            break;
+        case DataProfile::Repeated: {
+            // 重复块按文件偏移对齐，分块大小不是块大小的整数倍时也能保持连续
+            const std::vector<char>& block = state.repeated_block;
+            for (size_t done = 0; done < length; ) {
+                size_t in_block = static_cast<size_t>((offset + done) % block.size());
+                size_t n = std::min(block.size() - in_block, length - done);
+                memcpy(data + done, block.data() + in_block, n);
+                done += n;
+            }
+            ok = write_all_at(fd, data, length, offset);
+            break;
+        }
+        }
+
+        if (!ok) {
+            state.fail(std::string("Error writing test file: ") + strerror(errno));
+            break;
+        }
+        state.report(length);
+    }
+}
+
+} // namespace
+
+bool generate_test_file(const std::string& path, uint64_t size, const TestDataOptions& options) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        std::cerr << "Error creating test file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+#ifdef __linux__
+    // 预分配避免并发写入时的块分配竞争和碎片；Sparse需要保留空洞
+    if (options.profile != DataProfile::Sparse && size > 0 &&
+        fallocate(fd, 0, 0, static_cast<off_t>(size)) == -1 &&
+        errno != EOPNOTSUPP && errno != ENOSYS) {
+        std::cerr << "Error preallocating test file: " << strerror(errno) << std::endl;
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+#endif
+
+    GeneratorState state;
+    state.options = &options;
+    state.size = size;
+    if (options.profile == DataProfile::Repeated) {
+        state.repeated_block.resize(std::max<size_t>(options.block_size, 1));
+        fill_random(state.repeated_block.data(), state.repeated_block.size(), options.seed, 0);
+    }
+
+    unsigned threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    uint64_t chunks = (size + kChunkSize - 1) / kChunkSize;
+    threads = std::max(threads, 1u);
+    if (chunks < threads) {
+        threads = static_cast<unsigned>(std::max<uint64_t>(chunks, 1));
+    }
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(generate_worker, fd, std::ref(state));
+        }
+    } catch (const std::system_error&) {
+        // 线程创建失败时由已有线程和当前线程完成剩余分块
+    }
+    generate_worker(fd, state);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Sparse末尾可能是空洞，需要显式设置文件大小
+    bool success = !state.abort.load();
+    if (success && ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        state.error = std::string("Error setting test file size: ") + strerror(errno);
+        success = false;
+    }
+    if (close(fd) == -1 && success) {
+        state.error = std::string("Error closing test file: ") + strerror(errno);
+        success = false;
+    }
+    if (!success) {
+        std::cerr << state.error << std::endl;
+        unlink(path.c_str());
+    }
+    return success;
+}
+
+} // namespace zero_copy
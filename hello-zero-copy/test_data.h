@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 测试文件的内容类型
+enum class DataProfile {
+    Random,     // 不可压缩的随机数据
+    Zeros,      // 实际写入的全零数据（不是空洞）
+    Text,       // 由少量单词组成的可压缩文本
+    Sparse,     // 随机数据区段与空洞交替
+    Repeated    // 同一个随机块重复出现，适合测试去重和增量复制
+};
+
+const char* data_profile_name(DataProfile profile);
+
+// 按名称解析，未知名称返回false
+bool parse_data_profile(const std::string& name, DataProfile& profile);
+
+struct TestDataOptions {
+    DataProfile profile = DataProfile::Random;
+    uint64_t seed = 0;              // 相同的种子和大小生成相同的内容，与线程数无关
+    unsigned threads = 0;           // 0表示使用硬件并发数
+    size_t block_size = 64 * 1024;  // Repeated的重复单位
+    unsigned sparse_data_percent = 25; // Sparse中数据区段（1MB一段）所占的百分比
+    // 每写完一个分块调用一次，参数为已完成和总字节数；会被多个线程串行调用
+    std::function<void(uint64_t, uint64_t)> on_progress;
+};
+
+// 多线程生成测试文件
+// 文件按4MB分块，各线程用pwrite写入互不重叠的分块，写入前用fallocate预分配
+// （Sparse不预分配，空洞部分不写入）。失败时删除不完整的文件。
+bool generate_test_file(const std::string& path, uint64_t size,
+                        const TestDataOptions& options = TestDataOptions());
+
+} // namespace zero_copy
@@ -0,0 +1,440 @@
+#include "tree_copy.h"
+#include "parallel_copy.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+namespace {
+
+struct FileEntry {
+    std::string name;
+    mode_t mode = 0;
+    uint64_t size = 0;
+};
+
+// 目录任务遍历src并在dst中创建子目录；批次任务复制同一目录中的一批小文件
+struct TreeTask {
+    bool is_directory = true;
+    std::string src;
+    std::string dst;
+    std::vector<FileEntry> files;
+};
+
+struct LargeFile {
+    std::string src;
+    std::string dst;
+    uint64_t size = 0;
+};
+
+// 所有工作线程共享的状态
+struct TreeCopyState {
+    TreeCopyOptions options;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<TreeTask> queue;
+    size_t active = 0;              // 已取出但还没有完成的任务数，可能还会产生新任务
+    std::vector<LargeFile> large_files;
+    // 新建的目标目录和源目录的权限，创建时加了S_IRWXU以便写入内容，全部复制完成后恢复。
+    // 子目录总在父目录之后加入
+    std::vector<std::pair<std::string, mode_t>> directory_modes;
+
+    std::atomic<uint64_t> directories{0};
+    std::atomic<uint64_t> small_files{0};
+    std::atomic<uint64_t> symlinks{0};
+    std::atomic<uint64_t> bytes_copied{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> errors{0};
+
+    // 目标根目录，遍历时遇到它说明目标位于源目录树之内
+    dev_t dst_dev = 0;
+    ino_t dst_ino = 0;
+    std::mutex error_mutex;
+
+    // 目录任务放在队首，让遍历和mkdir走在数据复制前面
+    void push(TreeTask task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (task.is_directory) {
+                queue.push_front(std::move(task));
+            } else {
+                queue.push_back(std::move(task));
+            }
+        }
+        cv.notify_one();
+    }
+
+    void report(const std::string& what, const std::string& path, int error) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(error_mutex);
+        std::cerr << "Error " << what << " " << path << ": " << strerror(error) << std::endl;
+    }
+
+    void report_into_itself(const std::string& path) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(error_mutex);
+        std::cerr << "Error: cannot copy a directory into itself, destination " << path
+                  << " is inside the source tree" << std::endl;
+    }
+};
+
+std::string join_path(const std::string& dir, const char* name) {
+    return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+// 复制一个已打开目录中的小文件，优先使用copy_file_range
+bool copy_small_file(int src_dirfd, int dst_dirfd, const FileEntry& entry, const std::string& src_dir,
+                     const std::string& dst_dir, TreeCopyState& state) {
+    int src_fd = openat(src_dirfd, entry.name.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (src_fd == -1) {
+        state.report("opening", join_path(src_dir, entry.name.c_str()), errno);
+        return false;
+    }
+    int dst_fd = openat(dst_dirfd, entry.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, entry.mode & 07777);
+    if (dst_fd == -1) {
+        state.report("creating", join_path(dst_dir, entry.name.c_str()), errno);
+        close(src_fd);
+        return false;
+    }
+
+    bool ok = true;
+    uint64_t copied = 0;
+    bool use_copy_file_range = true;
+    std::vector<char> buffer;
+    while (ok && copied < entry.size) {
+        ssize_t n = -1;
+#ifdef __linux__
+        if (use_copy_file_range) {
+            n = copy_file_range(src_fd, NULL, dst_fd, NULL, static_cast<size_t>(entry.size - copied), 0);
+            if (n == -1 && copied == 0 &&
+                (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL)) {
+                use_copy_file_range = false;
+                continue;
+            }
+        }
+#else
+        use_copy_file_range = false;
+#endif
+        if (!use_copy_file_range) {
+            if (buffer.empty()) {
+                buffer.resize(static_cast<size_t>(std::min<uint64_t>(entry.size, 1024 * 1024)));
+            }
+            n = read(src_fd, buffer.data(), buffer.size());
+            for (ssize_t done = 0; n > 0 && done < n; ) {
+                ssize_t written = write(dst_fd, buffer.data() + done, n - done);
+                if (written == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    n = -1;
+                    break;
+                }
+                done += written;
+            }
+        }
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            state.report("copying", join_path(src_dir, entry.name.c_str()), errno);
+            ok = false;
+        } else if (n == 0) {
+            // 文件在遍历之后被截断，按实际内容复制
+            break;
+        } else {
+            copied += n;
+        }
+    }
+
+    close(src_fd);
+    if (close(dst_fd) == -1 && ok) {
+        state.report("closing", join_path(dst_dir, entry.name.c_str()), errno);
+        ok = false;
+    }
+    state.bytes_copied.fetch_add(copied, std::memory_order_relaxed);
+    return ok;
+}
+
+void run_batch(const TreeTask& task, TreeCopyState& state) {
+    // 整批文件共用两个目录fd，openat不必每次重新解析完整路径
+    int src_dirfd = open(task.src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (src_dirfd == -1) {
+        state.report("opening directory", task.src, errno);
+        return;
+    }
+    int dst_dirfd = open(task.dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dst_dirfd == -1) {
+        state.report("opening directory", task.dst, errno);
+        close(src_dirfd);
+        return;
+    }
+    for (const auto& entry : task.files) {
+        if (copy_small_file(src_dirfd, dst_dirfd, entry, task.src, task.dst, state)) {
+            state.small_files.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    close(src_dirfd);
+    close(dst_dirfd);
+}
+
+void copy_symlink(int src_dirfd, int dst_dirfd, const char* name, const std::string& src_dir,
+                  TreeCopyState& state) {
+    std::vector<char> target(256);
+    for (;;) {
+        ssize_t n = readlinkat(src_dirfd, name, target.data(), target.size());
+        if (n == -1) {
+            state.report("reading link", join_path(src_dir, name), errno);
+            return;
+        }
+        if (static_cast<size_t>(n) < target.size()) {
+            target.resize(n);
+            break;
+        }
+        target.resize(target.size() * 2);
+    }
+    target.push_back('\0');
+    if (symlinkat(target.data(), dst_dirfd, name) == -1) {
+        // 目标已存在时替换它
+        if (errno != EEXIST || unlinkat(dst_dirfd, name, 0) == -1 ||
+            symlinkat(target.data(), dst_dirfd, name) == -1) {
+            state.report("creating link", join_path(src_dir, name), errno);
+            return;
+        }
+    }
+    state.symlinks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void run_directory(const TreeTask& task, TreeCopyState& state) {
+    int src_dirfd = open(task.src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (src_dirfd == -1) {
+        state.report("opening directory", task.src, errno);
+        return;
+    }
+    DIR* dir = fdopendir(src_dirfd);
+    if (!dir) {
+        state.report("reading directory", task.src, errno);
+        close(src_dirfd);
+        return;
+    }
+    int dst_dirfd = open(task.dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dst_dirfd == -1) {
+        state.report("opening directory", task.dst, errno);
+        closedir(dir);
+        return;
+    }
+
+    TreeTask batch;
+    batch.is_directory = false;
+    batch.src = task.src;
+    batch.dst = task.dst;
+
+    for (;;) {
+        errno = 0;
+        struct dirent* entry = readdir(dir);
+        if (!entry) {
+            if (errno != 0) {
+                state.report("reading directory", task.src, errno);
+            }
+            break;
+        }
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(src_dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+            state.report("reading", join_path(task.src, name), errno);
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            // 和cp -r一样不进入目标目录，否则会把复制出的内容再复制一遍直到路径过长
+            if (st.st_dev == state.dst_dev && st.st_ino == state.dst_ino) {
+                state.report_into_itself(join_path(task.src, name));
+                continue;
+            }
+            // 保证自己能在新目录中创建文件
+            if (mkdirat(dst_dirfd, name, (st.st_mode & 07777) | S_IRWXU) == -1 && errno != EEXIST) {
+                state.report("creating directory", join_path(task.dst, name), errno);
+                continue;
+            }
+            state.directories.fetch_add(1, std::memory_order_relaxed);
+            TreeTask child;
+            child.src = join_path(task.src, name);
+            child.dst = join_path(task.dst, name);
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.directory_modes.emplace_back(child.dst, st.st_mode & 07777);
+            }
+            state.push(std::move(child));
+        } else if (S_ISREG(st.st_mode)) {
+            uint64_t size = static_cast<uint64_t>(st.st_size);
+            if (size >= state.options.large_file_threshold) {
+                // 先创建目标文件以确定权限，数据在遍历结束后分块并行复制
+                int fd = openat(dst_dirfd, name, O_WRONLY | O_CREAT | O_CLOEXEC, st.st_mode & 07777);
+                if (fd == -1) {
+                    state.report("creating", join_path(task.dst, name), errno);
+                    continue;
+                }
+                close(fd);
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.large_files.push_back({join_path(task.src, name), join_path(task.dst, name), size});
+            } else {
+                batch.files.push_back({name, st.st_mode, size});
+                if (batch.files.size() >= state.options.batch_size) {
+                    state.push(batch);
+                    batch.files.clear();
+                }
+            }
+        } else if (S_ISLNK(st.st_mode)) {
+            copy_symlink(src_dirfd, dst_dirfd, name, task.src, state);
+        } else {
+            state.skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!batch.files.empty()) {
+        state.push(std::move(batch));
+    }
+
+    closedir(dir);
+    close(dst_dirfd);
+}
+
+void tree_worker(TreeCopyState& state) {
+    for (;;) {
+        TreeTask task;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.cv.wait(lock, [&]() { return !state.queue.empty() || state.active == 0; });
+            if (state.queue.empty()) {
+                return;
+            }
+            task = std::move(state.queue.front());
+            state.queue.pop_front();
+            ++state.active;
+        }
+
+        if (task.is_directory) {
+            run_directory(task, state);
+        } else {
+            run_batch(task, state);
+        }
+
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            --state.active;
+            done = state.active == 0 && state.queue.empty();
+        }
+        if (done) {
+            state.cv.notify_all();
+        }
+    }
+}
+
+} // namespace
+
+bool tree_copy(const std::string& src_dir, const std::string& dst_dir,
+               const TreeCopyOptions& options, TreeCopyStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    struct stat st;
+    if (stat(src_dir.c_str(), &st) == -1) {
+        std::cerr << "Error reading source directory: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        std::cerr << "Error: " << src_dir << " is not a directory" << std::endl;
+        return false;
+    }
+    if (mkdir(dst_dir.c_str(), (st.st_mode & 07777) | S_IRWXU) == -1 && errno != EEXIST) {
+        std::cerr << "Error creating destination directory: " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat dst_st;
+    if (stat(dst_dir.c_str(), &dst_st) == -1) {
+        std::cerr << "Error reading destination directory: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (dst_st.st_dev == st.st_dev && dst_st.st_ino == st.st_ino) {
+        std::cerr << "Error: cannot copy a directory into itself, " << dst_dir << " is the same as "
+                  << src_dir << std::endl;
+        return false;
+    }
+
+    TreeCopyState state;
+    state.dst_dev = dst_st.st_dev;
+    state.dst_ino = dst_st.st_ino;
+    state.options = options;
+    state.options.batch_size = std::max<size_t>(options.batch_size, 1);
+    TreeTask root;
+    root.src = src_dir;
+    root.dst = dst_dir;
+    state.queue.push_back(std::move(root));
+
+    unsigned threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(tree_worker, std::ref(state));
+        }
+    } catch (const std::system_error&) {
+        // 线程创建失败时由已有线程和当前线程完成剩余任务
+    }
+    tree_worker(state);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // 大文件逐个复制，每个文件都由所有线程分块并行完成
+    uint64_t large_files = 0;
+    for (const auto& file : state.large_files) {
+        if (parallel_copy(file.src, file.dst, threads)) {
+            ++large_files;
+            state.bytes_copied.fetch_add(file.size, std::memory_order_relaxed);
+        } else {
+            state.errors.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "Error copying " << file.src << std::endl;
+        }
+    }
+
+    // 先子目录后父目录，父目录没有写或搜索权限时也不影响子目录
+    state.directory_modes.emplace_back(dst_dir, st.st_mode & 07777);
+    for (auto it = state.directory_modes.rbegin(); it != state.directory_modes.rend(); ++it) {
+        if (chmod(it->first.c_str(), it->second) == -1) {
+            state.report("setting permissions of", it->first, errno);
+        }
+    }
+
+    if (stats) {
+        stats->directories = state.directories.load();
+        stats->small_files = state.small_files.load();
+        stats->large_files = large_files;
+        stats->symlinks = state.symlinks.load();
+        stats->bytes_copied = state.bytes_copied.load();
+        stats->skipped = state.skipped.load();
+        stats->errors = state.errors.load();
+        stats->elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+    return state.errors.load() == 0;
+}
+
+} // namespace zero_copy
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+struct TreeCopyOptions {
+    unsigned threads = 0;                           // 0表示使用硬件并发数
+    uint64_t large_file_threshold = 64ull << 20;    // 不小于该值的文件用parallel_copy分块并行复制
+    size_t batch_size = 256;                        // 同一目录中的小文件每批最多的个数
+};
+
+struct TreeCopyStats {
+    uint64_t directories = 0;
+    uint64_t small_files = 0;
+    uint64_t large_files = 0;
+    uint64_t symlinks = 0;
+    uint64_t bytes_copied = 0;
+    uint64_t skipped = 0;           // 设备文件、FIFO、socket等不复制的条目
+    uint64_t errors = 0;
+    std::chrono::microseconds elapsed{0};
+};
+
+// 并行复制整个目录树
+// 工作线程从共享队列中取任务：目录任务读取目录（readdir，必要时fstatat），
+// 立即创建对应的目标子目录，并把子目录和小文件批次加入队列；
+// 目录任务优先执行，使mkdir等元数据操作走在数据复制前面。
+// 同一目录中的小文件按批次由一个线程通过openat和copy_file_range依次复制，
+// 大文件在目录遍历结束后逐个用parallel_copy由所有线程分块并行复制。
+// 单个条目失败时输出错误并继续，最后有任何错误则返回false。
+bool tree_copy(const std::string& src_dir, const std::string& dst_dir,
+               const TreeCopyOptions& options = TreeCopyOptions(), TreeCopyStats* stats = nullptr);
+
+} // namespace zero_copy
@@ -0,0 +1,291 @@
+#include "verified_copy.h"
+#include "checksum.h"
+#include "zero_copy_examples.h"
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+
+namespace zero_copy {
+
+const char* verified_copy_method_name(VerifiedCopyMethod method) {
+    switch (method) {
+    case VerifiedCopyMethod::Buffered:
+        return "buffered";
+    case VerifiedCopyMethod::Mmap:
+        return "mmap";
+    case VerifiedCopyMethod::Splice:
+        return "splice";
+    }
+    return "unknown";
+}
+
+namespace {
+
+const size_t kBufferSize = 1024 * 1024;
+// 每个映射窗口的大小
+const size_t kWindowSize = 64 * 1024 * 1024;
+// 复制和校验交替处理的块大小，保证刚复制的数据还在缓存里
+const size_t kHashBlock = 256 * 1024;
+
+bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t bytes_written = write(fd, data, length);
+        if (bytes_written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error writing to destination file: " << strerror(errno) << std::endl;
+            return false;
+        }
+        data += bytes_written;
+        length -= bytes_written;
+    }
+    return true;
+}
+
+bool buffered_hash_copy(int src_fd, int dst_fd, uint32_t& crc) {
+    std::vector<char> buffer(kBufferSize);
+    for (;;) {
+        ssize_t bytes_read = read(src_fd, buffer.data(), buffer.size());
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading from source file: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (bytes_read == 0) {
+            return true;
+        }
+        crc = crc32c(crc, buffer.data(), bytes_read);
+        if (!write_all(dst_fd, buffer.data(), bytes_read)) {
+            return false;
+        }
+    }
+}
+
+bool mmap_hash_copy(int src_fd, int dst_fd, off_t size, uint32_t& crc) {
+    if (ftruncate(dst_fd, size) == -1) {
+        std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
+        return false;
+    }
+    for (off_t offset = 0; offset < size; offset += kWindowSize) {
+        size_t length = static_cast<size_t>(std::min<off_t>(kWindowSize, size - offset));
+        void* src = mmap(NULL, length, PROT_READ, MAP_SHARED, src_fd, offset);
+        if (src == MAP_FAILED) {
+            std::cerr << "Error mapping source file: " << strerror(errno) << std::endl;
+            return false;
+        }
+        void* dst = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, dst_fd, offset);
+        if (dst == MAP_FAILED) {
+            std::cerr << "Error mapping destination file: " << strerror(errno) << std::endl;
+            munmap(src, length);
+            return false;
+        }
+        madvise(src, length, MADV_SEQUENTIAL);
+
+        const char* s = static_cast<const char*>(src);
+        char* d = static_cast<char*>(dst);
+        for (size_t done = 0; done < length; done += kHashBlock) {
+            size_t block = std::min(kHashBlock, length - done);
+            memcpy(d + done, s + done, block);
+            crc = crc32c(crc, s + done, block);
+        }
+
+        munmap(src, length);
+        munmap(dst, length);
+    }
+    return true;
+}
+
+#ifdef __linux__
+// 源 -> 管道A，tee把管道A中的页复制到管道B（不消耗A），
+// 从B读出的数据用于计算校验和，A中的数据splice到目标文件
+bool splice_hash_copy(int src_fd, int dst_fd, uint32_t& crc) {
+    int data_pipe[2];
+    int hash_pipe[2];
+    if (pipe(data_pipe) == -1) {
+        std::cerr << "Error creating pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pipe(hash_pipe) == -1) {
+        std::cerr << "Error creating pipe: " << strerror(errno) << std::endl;
+        close(data_pipe[0]);
+        close(data_pipe[1]);
+        return false;
+    }
+
+    std::vector<char> buffer(65536);
+    bool success = true;
+    while (success) {
+        ssize_t in_pipe = splice(src_fd, NULL, data_pipe[1], NULL, buffer.size(), SPLICE_F_MOVE);
+        if (in_pipe == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error splicing from source to pipe: " << strerror(errno) << std::endl;
+            success = false;
+            break;
+        }
+        if (in_pipe == 0) {
+            break;
+        }
+
+        ssize_t remaining = in_pipe;
+        while (remaining > 0 && success) {
+            // tee总是从管道A的头部开始复制，所以每次复制的部分都要先从A中消耗掉
+            ssize_t teed = tee(data_pipe[0], hash_pipe[1], remaining, 0);
+            if (teed == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error duplicating pipe data: " << strerror(errno) << std::endl;
+                success = false;
+                break;
+            }
+
+            ssize_t hashed = 0;
+            while (hashed < teed) {
+                ssize_t n = read(hash_pipe[0], buffer.data(), teed - hashed);
+                if (n == -1 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    std::cerr << "Error reading from hash pipe: " << strerror(errno) << std::endl;
+                    success = false;
+                    break;
+                }
+                crc = crc32c(crc, buffer.data(), n);
+                hashed += n;
+            }
+
+            ssize_t written = 0;
+            while (success && written < teed) {
+                ssize_t n = splice(data_pipe[0], NULL, dst_fd, NULL, teed - written, SPLICE_F_MOVE);
+                if (n == -1 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    std::cerr << "Error splicing from pipe to destination: " << strerror(errno) << std::endl;
+                    success = false;
+                    break;
+                }
+                written += n;
+            }
+            remaining -= teed;
+        }
+    }
+
+    close(data_pipe[0]);
+    close(data_pipe[1]);
+    close(hash_pipe[0]);
+    close(hash_pipe[1]);
+    return success;
+}
+#endif
+
+} // namespace
+
+bool file_crc32c(const std::string& path, uint32_t& crc) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error opening file: " << strerror(errno) << std::endl;
+        return false;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    std::vector<char> buffer(kBufferSize);
+    crc = 0;
+    bool success = true;
+    for (;;) {
+        ssize_t bytes_read = read(fd, buffer.data(), buffer.size());
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading file: " << strerror(errno) << std::endl;
+            success = false;
+            break;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        crc = crc32c(crc, buffer.data(), bytes_read);
+    }
+    close(fd);
+    return success;
+}
+
+bool verified_copy(const std::string& src_path, const std::string& dst_path,
+                   VerifiedCopyMethod method, VerifiedCopyResult* result, bool verify_destination) {
+    VerifiedCopyResult local_result;
+    VerifiedCopyResult& res = result ? *result : local_result;
+    res = VerifiedCopyResult();
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+
+    uint32_t crc = 0;
+    bool success = false;
+    switch (method) {
+    case VerifiedCopyMethod::Buffered:
+        success = buffered_hash_copy(src_fd, dst_fd, crc);
+        break;
+    case VerifiedCopyMethod::Mmap:
+        success = mmap_hash_copy(src_fd, dst_fd, src_size, crc);
+        break;
+    case VerifiedCopyMethod::Splice:
+#ifdef __linux__
+        success = splice_hash_copy(src_fd, dst_fd, crc);
+#else
+        success = buffered_hash_copy(src_fd, dst_fd, crc);
+#endif
+        break;
+    }
+
+    close(src_fd);
+    close(dst_fd);
+    if (!success) {
+        return false;
+    }
+    res.source_crc = crc;
+
+    if (verify_destination) {
+        if (!file_crc32c(dst_path, res.destination_crc)) {
+            return false;
+        }
+        res.destination_checked = true;
+        res.match = res.destination_crc == res.source_crc;
+        if (!res.match) {
+            std::cerr << "Error: checksum mismatch after copy" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace zero_copy
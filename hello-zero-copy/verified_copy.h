@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace zero_copy {
+
+// 带校验的复制所使用的数据通路
+enum class VerifiedCopyMethod {
+    Buffered,   // read/write，在用户态缓冲区上计算校验和
+    Mmap,       // 按窗口映射后复制，复制和计算校验和共用同一次遍历
+    Splice      // splice + tee，把管道页复制一份给用户态做校验
+};
+
+const char* verified_copy_method_name(VerifiedCopyMethod method);
+
+struct VerifiedCopyResult {
+    uint32_t source_crc = 0;        // 复制过程中计算的源数据CRC32C
+    uint32_t destination_crc = 0;   // 仅在verify_destination时计算
+    bool destination_checked = false;
+    bool match = true;              // 未检查目标文件时恒为true
+};
+
+// 复制的同时计算数据流的CRC32C，避免复制后再完整读取两个文件
+// verify_destination为true时会额外读取目标文件并比较校验和。
+bool verified_copy(const std::string& src_path, const std::string& dst_path,
+                   VerifiedCopyMethod method = VerifiedCopyMethod::Mmap,
+                   VerifiedCopyResult* result = nullptr, bool verify_destination = false);
+
+// 计算整个文件的CRC32C
+bool file_crc32c(const std::string& path, uint32_t& crc);
+
+} // namespace zero_copy
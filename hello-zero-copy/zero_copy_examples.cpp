@@ -1,8 +1,13 @@
 #include "zero_copy_examples.h"
+#include "copy_benchmark.h"
+#include "splice_engine.h"
+#include "streaming_memcpy.h"
+#include "mapped_file.h"
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <vector>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -12,6 +17,12 @@
 
 #ifdef __linux__
 #include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define ZERO_COPY_HAVE_IO_URING 1
+#endif
 #elif defined(__APPLE__)
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -76,63 +87,208 @@ bool traditional_copy(const std::string& src_path, const std::string& dst_path,
 }
 
 // 使用mmap/munmap的零拷贝方法
-bool mmap_copy(const std::string& src_path, const std::string& dst_path) {
-    int src_fd = open(src_path.c_str(), O_RDONLY);
-    if (src_fd == -1) {
-        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
-        return false;
-    }
-
-    off_t src_size = get_file_size(src_fd);
-    if (src_size == -1) {
-        close(src_fd);
+bool mmap_copy(const std::string& src_path, const std::string& dst_path, bool non_temporal) {
+    // 映射源文件到内存
+    MappedFileOptions src_options;
+    src_options.hint = AccessHint::Sequential;
+    MappedFile src;
+    if (!src.open(src_path, src_options)) {
         return false;
     }
+    off_t src_size = static_cast<off_t>(src.size());
 
     int dst_fd = open(dst_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
     if (dst_fd == -1) {
         std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
-        close(src_fd);
         return false;
     }
 
     // 设置目标文件大小
     if (ftruncate(dst_fd, src_size) == -1) {
         std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
-        close(src_fd);
         close(dst_fd);
         return false;
     }
-
-    // 映射源文件到内存
-    void* src_mmap = mmap(NULL, src_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
-    if (src_mmap == MAP_FAILED) {
-        std::cerr << "Error mapping source file: " << strerror(errno) << std::endl;
-        close(src_fd);
+    // 空文件不能映射，设置大小后即完成
+    if (src_size == 0) {
         close(dst_fd);
-        return false;
+        return true;
     }
 
     // 映射目标文件到内存
     void* dst_mmap = mmap(NULL, src_size, PROT_READ | PROT_WRITE, MAP_SHARED, dst_fd, 0);
     if (dst_mmap == MAP_FAILED) {
         std::cerr << "Error mapping destination file: " << strerror(errno) << std::endl;
-        munmap(src_mmap, src_size);
-        close(src_fd);
         close(dst_fd);
         return false;
     }
 
     // 直接在内存中复制数据
-    memcpy(dst_mmap, src_mmap, src_size);
+    ByteSpan data = src.data();
+    if (non_temporal) {
+        copy_memory(dst_mmap, data.data(), data.size());
+    } else {
+        memcpy(dst_mmap, data.data(), data.size());
+    }
 
     // 解除映射
-    munmap(src_mmap, src_size);
     munmap(dst_mmap, src_size);
+    close(dst_fd);
+    return true;
+}
+
+namespace {
+
+// 映射源文件的一个窗口并给出访问提示，失败时返回MAP_FAILED
+void* map_source_window(int fd, off_t offset, size_t length, const MmapWindowOptions& options) {
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (options.populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* addr = mmap(NULL, length, PROT_READ, flags, fd, offset);
+    if (addr == MAP_FAILED) {
+        return addr;
+    }
+    madvise(addr, length, MADV_SEQUENTIAL);
+    madvise(addr, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) {
+        madvise(addr, length, MADV_HUGEPAGE);
+    }
+#endif
+    return addr;
+}
+
+} // namespace
+
+// 使用滑动窗口mmap的流式复制方法
+bool mmap_window_copy(const std::string& src_path, const std::string& dst_path,
+                      const MmapWindowOptions& options) {
+    // 窗口按2MB对齐，既满足mmap的页对齐要求，也便于使用透明大页
+    const size_t alignment = 2 * 1024 * 1024;
+    size_t window = std::max(options.window_size, alignment);
+    window = (window + alignment - 1) / alignment * alignment;
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    // 设置目标文件大小
+    if (ftruncate(dst_fd, src_size) == -1) {
+        std::cerr << "Error setting destination file size: " << strerror(errno) << std::endl;
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+
+    auto window_length = [&](off_t offset) {
+        return static_cast<size_t>(std::min<off_t>(window, src_size - offset));
+    };
+
+    bool success = true;
+    void* src_next = MAP_FAILED;
+    size_t src_next_length = 0;
+    off_t prev_offset = -1;
+    size_t prev_length = 0;
+
+    for (off_t offset = 0; offset < src_size; offset += window) {
+        size_t length = window_length(offset);
+
+        // 当前窗口已经在上一轮作为“下一个窗口”映射过
+        void* src_cur = src_next;
+        src_next = MAP_FAILED;
+        if (src_cur == MAP_FAILED) {
+            src_cur = map_source_window(src_fd, offset, length, options);
+            if (src_cur == MAP_FAILED) {
+                std::cerr << "Error mapping source file: " << strerror(errno) << std::endl;
+                success = false;
+                break;
+            }
+        }
+
+        // 提前映射下一个窗口，让内核在复制当前窗口时预读
+        off_t next_offset = offset + window;
+        if (next_offset < src_size) {
+            src_next_length = window_length(next_offset);
+            src_next = map_source_window(src_fd, next_offset, src_next_length, options);
+        }
+
+        int dst_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        if (options.populate) {
+            dst_flags |= MAP_POPULATE;
+        }
+#endif
+        void* dst_cur = mmap(NULL, length, PROT_READ | PROT_WRITE, dst_flags, dst_fd, offset);
+        if (dst_cur == MAP_FAILED) {
+            std::cerr << "Error mapping destination file: " << strerror(errno) << std::endl;
+            munmap(src_cur, length);
+            success = false;
+            break;
+        }
+#ifdef MADV_HUGEPAGE
+        if (options.huge_pages) {
+            madvise(dst_cur, length, MADV_HUGEPAGE);
+        }
+#endif
+
+        if (options.non_temporal) {
+            copy_memory(dst_cur, src_cur, length);
+        } else {
+            memcpy(dst_cur, src_cur, length);
+        }
+
+        // 立即发起这个窗口的回写，让写盘和下一个窗口的复制重叠
+        if (options.sync_each_window) {
+            msync(dst_cur, length, MS_ASYNC);
+#ifdef __linux__
+            sync_file_range(dst_fd, offset, length, SYNC_FILE_RANGE_WRITE);
+#endif
+        }
+
+        munmap(dst_cur, length);
+        madvise(src_cur, length, MADV_DONTNEED);
+        munmap(src_cur, length);
+
+        // 等待上一个窗口写回完成后把它从页缓存中丢弃，限制脏页和缓存占用
+        if (options.drop_behind && prev_offset >= 0) {
+#ifdef __linux__
+            sync_file_range(dst_fd, prev_offset, prev_length,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#if defined(POSIX_FADV_DONTNEED)
+            posix_fadvise(dst_fd, prev_offset, prev_length, POSIX_FADV_DONTNEED);
+            posix_fadvise(src_fd, prev_offset, prev_length, POSIX_FADV_DONTNEED);
+#endif
+        }
+        prev_offset = offset;
+        prev_length = length;
+    }
+
+    if (src_next != MAP_FAILED) {
+        munmap(src_next, src_next_length);
+    }
 
     close(src_fd);
     close(dst_fd);
-    return true;
+    return success;
 }
 
 // 使用sendfile的零拷贝方法
@@ -214,6 +370,13 @@ bool sendfile_copy(const std::string& src_path, const std::string& dst_path) {
 
 // 使用splice的零拷贝方法
 bool splice_copy(const std::string& src_path, const std::string& dst_path) {
+    // 管道来自线程局部的池并扩大到pipe-max-size，连续复制多个文件时不再重复创建
+    SpliceEngine engine;
+    return engine.copy(src_path, dst_path);
+}
+
+// 使用copy_file_range的内核内复制方法
+bool copy_file_range_copy(const std::string& src_path, const std::string& dst_path) {
 #ifdef __linux__
     int src_fd = open(src_path.c_str(), O_RDONLY);
     if (src_fd == -1) {
@@ -235,62 +398,394 @@ bool splice_copy(const std::string& src_path, const std::string& dst_path) {
         return false;
     }
 
-    int pipe_fds[2];
-    if (pipe(pipe_fds) == -1) {
-        std::cerr << "Error creating pipe: " << strerror(errno) << std::endl;
+    // 数据完全在内核中移动；支持reflink的文件系统上不会产生实际的数据复制
+    off_t offset_in = 0;
+    off_t offset_out = 0;
+    while (offset_in < src_size) {
+        ssize_t bytes_copied = copy_file_range(src_fd, &offset_in, dst_fd, &offset_out,
+                                               src_size - offset_in, 0);
+        if (bytes_copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 旧内核或跨文件系统不支持时，回退到sendfile
+            if (offset_in == 0 && (errno == ENOSYS || errno == EXDEV ||
+                                   errno == EOPNOTSUPP || errno == EINVAL)) {
+                std::cerr << "copy_file_range not supported (" << strerror(errno)
+                          << "), falling back to sendfile" << std::endl;
+                close(src_fd);
+                close(dst_fd);
+                return sendfile_copy(src_path, dst_path);
+            }
+            std::cerr << "Error during copy_file_range: " << strerror(errno) << std::endl;
+            close(src_fd);
+            close(dst_fd);
+            return false;
+        }
+        if (bytes_copied == 0) {
+            // 源文件在复制过程中被截断
+            break;
+        }
+    }
+
+    close(src_fd);
+    close(dst_fd);
+    return true;
+#else
+    std::cerr << "copy_file_range is only available on Linux systems" << std::endl;
+    return false;
+#endif
+}
+
+#ifdef ZERO_COPY_HAVE_IO_URING
+namespace {
+
+// 不依赖liburing的最小io_uring封装，只实现复制所需的提交/完成操作
+class IoUring {
+public:
+    explicit IoUring(unsigned entries) {
+        memset(&params_, 0, sizeof(params_));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params_));
+        if (ring_fd_ == -1) {
+            return;
+        }
+
+        sq_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cq_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = (params_.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap_) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+
+        sq_ptr_ = mmap(NULL, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            reset();
+            return;
+        }
+        cq_ptr_ = single_mmap_ ? sq_ptr_
+                               : mmap(NULL, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            reset();
+            return;
+        }
+        sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            reset();
+            return;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+
+        sqe_tail_ = submitted_tail_ = *sq_tail_;
+    }
+
+    ~IoUring() { reset(); }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool ok() const { return sqes_ != nullptr; }
+
+    // 注册固定缓冲区，之后可用READ_FIXED/WRITE_FIXED免去每次I/O的页表固定开销
+    bool register_buffers(const iovec* iovs, unsigned count) {
+        return syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iovs, count) == 0;
+    }
+
+    // 获取一个空闲的SQE；提交队列已满时返回nullptr
+    io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= params_.sq_entries) {
+            return nullptr;
+        }
+        unsigned index = sqe_tail_ & sq_mask_;
+        sq_array_[index] = index;
+        ++sqe_tail_;
+        io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // 提交所有新的SQE并至少等待wait_nr个完成事件
+    int submit_and_wait(unsigned wait_nr) {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        unsigned to_submit = sqe_tail_ - submitted_tail_;
+        for (;;) {
+            long ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr,
+                               wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ret >= 0) {
+                submitted_tail_ = sqe_tail_;
+            }
+            return ret < 0 ? -errno : static_cast<int>(ret);
+        }
+    }
+
+    // 取下一个完成事件，没有则返回nullptr；处理完后需调用cqe_seen
+    io_uring_cqe* peek_cqe() {
+        unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &cqes_[head & cq_mask_];
+    }
+
+    void cqe_seen() {
+        __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    void reset() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (cq_ptr_ != MAP_FAILED && !single_mmap_) {
+            munmap(cq_ptr_, cq_size_);
+        }
+        cq_ptr_ = MAP_FAILED;
+        if (sq_ptr_ != MAP_FAILED) {
+            munmap(sq_ptr_, sq_size_);
+            sq_ptr_ = MAP_FAILED;
+        }
+        if (ring_fd_ != -1) {
+            close(ring_fd_);
+            ring_fd_ = -1;
+        }
+    }
+
+    int ring_fd_ = -1;
+    io_uring_params params_;
+    bool single_mmap_ = false;
+    void* sq_ptr_ = MAP_FAILED;
+    void* cq_ptr_ = MAP_FAILED;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned sqe_tail_ = 0;
+    unsigned submitted_tail_ = 0;
+};
+
+// 同步复制一个区间，用于io_uring短读/短写后的补齐
+bool pread_pwrite_range(int src_fd, int dst_fd, char* buffer, off_t offset, size_t length) {
+    while (length > 0) {
+        ssize_t bytes_read = pread(src_fd, buffer, length, offset);
+        if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return bytes_read == 0; // 源文件被截断时视为结束
+        }
+        ssize_t done = 0;
+        while (done < bytes_read) {
+            ssize_t bytes_written = pwrite(dst_fd, buffer + done, bytes_read - done, offset + done);
+            if (bytes_written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += bytes_written;
+        }
+        offset += bytes_read;
+        length -= bytes_read;
+    }
+    return true;
+}
+
+} // namespace
+#endif
+
+// 使用io_uring的批量异步复制方法
+bool io_uring_copy(const std::string& src_path, const std::string& dst_path,
+                   unsigned queue_depth, size_t block_size) {
+#ifdef ZERO_COPY_HAVE_IO_URING
+    if (queue_depth == 0 || block_size == 0) {
+        std::cerr << "Error: queue depth and block size must be greater than 0" << std::endl;
+        return false;
+    }
+
+    int src_fd = open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+        std::cerr << "Error opening source file: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int dst_fd = open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd == -1) {
+        std::cerr << "Error opening destination file: " << strerror(errno) << std::endl;
+        close(src_fd);
+        return false;
+    }
+
+    off_t src_size = get_file_size(src_fd);
+    if (src_size == -1) {
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+    if (src_size == 0) {
+        close(src_fd);
+        close(dst_fd);
+        return true;
+    }
+
+    // 小文件不需要那么多槽位
+    off_t block_count = (src_size + block_size - 1) / block_size;
+    unsigned depth = static_cast<unsigned>(std::min<off_t>(queue_depth, block_count));
+
+    // 每个槽位占用一个读SQE和一个链接在其后的写SQE
+    IoUring ring(depth * 2);
+    if (!ring.ok()) {
+        std::cerr << "Error setting up io_uring: " << strerror(errno) << std::endl;
         close(src_fd);
         close(dst_fd);
         return false;
     }
 
-    size_t bytes_remaining = src_size;
-    const size_t chunk_size = 65536; // 64KB chunks
-    
-    while (bytes_remaining > 0) {
-        size_t to_copy = std::min(bytes_remaining, chunk_size);
-        
-        // 从源文件拷贝到管道
-        ssize_t bytes_spliced = splice(src_fd, NULL, pipe_fds[1], NULL, to_copy, SPLICE_F_MOVE);
-        if (bytes_spliced <= 0) {
-            if (errno == EAGAIN || errno == EINTR) {
-                continue;
-            }
-            std::cerr << "Error splicing from source to pipe: " << strerror(errno) << std::endl;
-            close(pipe_fds[0]);
-            close(pipe_fds[1]);
+    void* buffer_mem = nullptr;
+    if (posix_memalign(&buffer_mem, 4096, depth * block_size) != 0) {
+        std::cerr << "Error allocating io_uring buffers" << std::endl;
+        close(src_fd);
+        close(dst_fd);
+        return false;
+    }
+    char* buffers = static_cast<char*>(buffer_mem);
+
+    std::vector<iovec> iovs(depth);
+    for (unsigned i = 0; i < depth; ++i) {
+        iovs[i].iov_base = buffers + i * block_size;
+        iovs[i].iov_len = block_size;
+    }
+    // RLIMIT_MEMLOCK不足时注册会失败，此时退回普通的READ/WRITE操作
+    bool fixed_buffers = ring.register_buffers(iovs.data(), depth);
+
+    struct Slot {
+        off_t offset = 0;
+        size_t length = 0;
+        int read_res = 0;
+        int write_res = 0;
+        int pending = 0;
+    };
+    std::vector<Slot> slots(depth);
+
+    off_t next_offset = 0;
+    unsigned inflight = 0;
+    bool success = true;
+
+    auto queue_slot = [&](unsigned i) {
+        Slot& slot = slots[i];
+        slot.offset = next_offset;
+        slot.length = static_cast<size_t>(std::min<off_t>(block_size, src_size - next_offset));
+        slot.pending = 2;
+        next_offset += slot.length;
+
+        io_uring_sqe* read_sqe = ring.get_sqe();
+        read_sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        read_sqe->fd = src_fd;
+        read_sqe->addr = reinterpret_cast<uint64_t>(iovs[i].iov_base);
+        read_sqe->len = static_cast<uint32_t>(slot.length);
+        read_sqe->off = static_cast<uint64_t>(slot.offset);
+        read_sqe->buf_index = static_cast<uint16_t>(i);
+        read_sqe->flags = IOSQE_IO_LINK;
+        read_sqe->user_data = (static_cast<uint64_t>(i) << 1);
+
+        io_uring_sqe* write_sqe = ring.get_sqe();
+        write_sqe->opcode = fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        write_sqe->fd = dst_fd;
+        write_sqe->addr = reinterpret_cast<uint64_t>(iovs[i].iov_base);
+        write_sqe->len = static_cast<uint32_t>(slot.length);
+        write_sqe->off = static_cast<uint64_t>(slot.offset);
+        write_sqe->buf_index = static_cast<uint16_t>(i);
+        write_sqe->user_data = (static_cast<uint64_t>(i) << 1) | 1;
+
+        ++inflight;
+    };
+
+    for (unsigned i = 0; i < depth && next_offset < src_size; ++i) {
+        queue_slot(i);
+    }
+
+    while (inflight > 0) {
+        int ret = ring.submit_and_wait(1);
+        if (ret < 0) {
+            // 无法再与内核交互，缓冲区可能仍被占用，只能放弃释放
+            std::cerr << "Error submitting to io_uring: " << strerror(-ret) << std::endl;
             close(src_fd);
             close(dst_fd);
             return false;
         }
-        
-        // 从管道拷贝到目标文件
-        ssize_t bytes_written = 0;
-        while (bytes_written < bytes_spliced) {
-            ssize_t res = splice(pipe_fds[0], NULL, dst_fd, NULL, bytes_spliced - bytes_written, SPLICE_F_MOVE);
-            if (res <= 0) {
-                if (errno == EAGAIN || errno == EINTR) {
-                    continue;
+
+        io_uring_cqe* cqe;
+        while ((cqe = ring.peek_cqe()) != nullptr) {
+            unsigned i = static_cast<unsigned>(cqe->user_data >> 1);
+            bool is_write = (cqe->user_data & 1) != 0;
+            Slot& slot = slots[i];
+            (is_write ? slot.write_res : slot.read_res) = cqe->res;
+            ring.cqe_seen();
+
+            if (--slot.pending > 0) {
+                continue;
+            }
+            --inflight;
+
+            if (slot.read_res < 0 && slot.read_res != -ECANCELED) {
+                std::cerr << "Error reading from source file: " << strerror(-slot.read_res) << std::endl;
+                success = false;
+            } else if (slot.write_res < 0 && slot.write_res != -ECANCELED) {
+                std::cerr << "Error writing to destination file: " << strerror(-slot.write_res) << std::endl;
+                success = false;
+            } else if (static_cast<size_t>(slot.write_res) != slot.length && success) {
+                // 短读会中断读写链，剩余部分同步补齐
+                if (!pread_pwrite_range(src_fd, dst_fd, static_cast<char*>(iovs[i].iov_base),
+                                        slot.offset, slot.length)) {
+                    std::cerr << "Error completing short io_uring transfer: " << strerror(errno) << std::endl;
+                    success = false;
                 }
-                std::cerr << "Error splicing from pipe to destination: " << strerror(errno) << std::endl;
-                close(pipe_fds[0]);
-                close(pipe_fds[1]);
-                close(src_fd);
-                close(dst_fd);
-                return false;
             }
-            bytes_written += res;
+
+            // 出错后不再提交新的请求，但仍需等待在途请求完成才能释放缓冲区
+            if (success && next_offset < src_size) {
+                queue_slot(i);
+            }
         }
-        
-        bytes_remaining -= bytes_spliced;
     }
-    
-    close(pipe_fds[0]);
-    close(pipe_fds[1]);
+
+    free(buffer_mem);
     close(src_fd);
     close(dst_fd);
-    return true;
+    return success;
 #else
-    std::cerr << "splice is only available on Linux systems" << std::endl;
+    (void)src_path;
+    (void)dst_path;
+    (void)queue_depth;
+    (void)block_size;
+    std::cerr << "io_uring is only available on Linux systems" << std::endl;
     return false;
 #endif
 }
@@ -298,7 +793,7 @@ bool splice_copy(const std::string& src_path, const std::string& dst_path) {
 // 比较不同复制方法的性能
 void compare_copy_methods(const std::string& src_path, const std::string& dst_path) {
     std::cout << "Comparing file copy methods for " << src_path << " -> " << dst_path << std::endl;
-    
+
     // 获取源文件大小
     int src_fd = open(src_path.c_str(), O_RDONLY);
     if (src_fd == -1) {
@@ -307,54 +802,52 @@ void compare_copy_methods(const std::string& src_path, const std::string& dst_pa
     }
     off_t file_size = get_file_size(src_fd);
     close(src_fd);
-    
+
     if (file_size == -1) {
         return;
     }
-    
+
     std::cout << "File size: " << file_size << " bytes" << std::endl;
-    
-    // 测试传统复制方法
-    std::string traditional_dst = dst_path + ".traditional";
-    auto traditional_time = measure_time(traditional_copy, src_path, traditional_dst, 4096);
-    std::cout << "Traditional copy: " << traditional_time.count() << " microseconds" << std::endl;
-    
-    // 测试mmap复制方法
-    std::string mmap_dst = dst_path + ".mmap";
-    auto mmap_time = measure_time(mmap_copy, src_path, mmap_dst);
-    std::cout << "mmap/munmap copy: " << mmap_time.count() << " microseconds" << std::endl;
-    
-#if defined(__linux__) || defined(__APPLE__)
-    // 测试sendfile复制方法
-    std::string sendfile_dst = dst_path + ".sendfile";
-    auto sendfile_time = measure_time(sendfile_copy, src_path, sendfile_dst);
-    std::cout << "sendfile copy: " << sendfile_time.count() << " microseconds" << std::endl;
-#endif
 
-#ifdef __linux__
-    // 测试splice复制方法
-    std::string splice_dst = dst_path + ".splice";
-    auto splice_time = measure_time(splice_copy, src_path, splice_dst);
-    std::cout << "splice copy: " << splice_time.count() << " microseconds" << std::endl;
-#endif
+    // 每种方法预热一次后重复测量，并在每次运行前清除页缓存，
+    // 避免后面的方法因为读到热缓存而显得更快
+    BenchmarkOptions options;
+    options.warmup_runs = 1;
+    options.repetitions = 3;
+    // 不扫描缓冲区大小：传统方法使用4KB作为基准，其他方法使用各自调好的默认值
+    options.buffer_sizes.clear();
+    options.window_sizes = {128 * 1024 * 1024};
+    auto results = benchmark_file(src_path, dst_path, options);
+    if (results.empty()) {
+        return;
+    }
+
+    std::cout << std::endl;
+    print_results_table(results, std::cout);
+
+    // 共享主机上CPU效率往往比绝对速度更重要
+    std::cout << "\nCPU cost per GB:" << std::endl;
+    print_cost_table(results, std::cout);
 
 #if !defined(__linux__) && !defined(__APPLE__)
     std::cout << "sendfile and splice methods are not available on this system" << std::endl;
 #elif !defined(__linux__)
-    std::cout << "splice method is only available on Linux systems" << std::endl;
-#endif
-    
-    std::cout << "\nPerformance comparison (lower is better):" << std::endl;
-    std::cout << "Traditional: 100%" << std::endl;
-    std::cout << "mmap/munmap: " << (mmap_time.count() * 100.0 / traditional_time.count()) << "%" << std::endl;
-    
-#if defined(__linux__) || defined(__APPLE__)
-    std::cout << "sendfile: " << (sendfile_time.count() * 100.0 / traditional_time.count()) << "%" << std::endl;
+    std::cout << "splice, copy_file_range and io_uring methods are only available on Linux systems" << std::endl;
 #endif
 
-#ifdef __linux__
-    std::cout << "splice: " << (splice_time.count() * 100.0 / traditional_time.count()) << "%" << std::endl;
-#endif
+    // 以传统方法的中位数为基准
+    const BenchmarkResult& baseline = results.front();
+    if (!baseline.ok || baseline.median_us <= 0) {
+        return;
+    }
+    std::cout << "\nPerformance comparison by median time (lower is better):" << std::endl;
+    for (const auto& result : results) {
+        if (!result.ok) {
+            std::cout << result.method << ": failed" << std::endl;
+            continue;
+        }
+        std::cout << result.method << ": " << (result.median_us * 100.0 / baseline.median_us) << "%" << std::endl;
+    }
 }
 
 } // namespace zero_copy
\ No newline at end of file
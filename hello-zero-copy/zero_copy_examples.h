@@ -3,14 +3,34 @@
 #include <string>
 #include <chrono>
 #include <functional>
+#include <sys/types.h>
 
 namespace zero_copy {
 
+// 获取文件大小的辅助函数，失败时返回-1
+off_t get_file_size(int fd);
+
 // 传统的文件复制方法（使用read/write系统调用）
 bool traditional_copy(const std::string& src_path, const std::string& dst_path, size_t buffer_size = 4096);
 
 // 使用mmap/munmap的零拷贝方法
-bool mmap_copy(const std::string& src_path, const std::string& dst_path);
+// non_temporal为true时，超过kStreamingCopyThreshold的文件用非临时存储复制，不污染CPU缓存
+bool mmap_copy(const std::string& src_path, const std::string& dst_path, bool non_temporal = true);
+
+// 滑动窗口mmap复制的选项
+struct MmapWindowOptions {
+    size_t window_size = 128 * 1024 * 1024; // 每个窗口映射的字节数，向上取整到2MB
+    bool populate = false;                  // 使用MAP_POPULATE预先建立页表
+    bool huge_pages = false;                // 对映射使用madvise(MADV_HUGEPAGE)
+    bool sync_each_window = true;           // 每个窗口写完后立即发起异步回写
+    bool drop_behind = true;                // 已完成的窗口从页缓存中丢弃
+    bool non_temporal = true;               // 大窗口使用非临时存储复制（见streaming_memcpy.h）
+};
+
+// 使用滑动窗口mmap的流式复制方法，适用于大于内存的文件
+// 同一时刻只映射当前窗口和预读的下一个窗口，脏页最多保留两个窗口
+bool mmap_window_copy(const std::string& src_path, const std::string& dst_path,
+                      const MmapWindowOptions& options = MmapWindowOptions());
 
 // 使用sendfile的零拷贝方法
 bool sendfile_copy(const std::string& src_path, const std::string& dst_path);
@@ -18,6 +38,14 @@ bool sendfile_copy(const std::string& src_path, const std::string& dst_path);
 // 使用splice的零拷贝方法
 bool splice_copy(const std::string& src_path, const std::string& dst_path);
 
+// 使用copy_file_range的内核内复制方法（XFS/Btrfs等文件系统上可直接reflink）
+bool copy_file_range_copy(const std::string& src_path, const std::string& dst_path);
+
+// 使用io_uring的批量异步复制方法
+// queue_depth个读写链（READ_FIXED -> WRITE_FIXED）同时在途，缓冲区预先注册到内核
+bool io_uring_copy(const std::string& src_path, const std::string& dst_path,
+                   unsigned queue_depth = 32, size_t block_size = 128 * 1024);
+
 // 测量函数执行时间的辅助函数
 template<typename Func, typename... Args>
 std::chrono::microseconds measure_time(Func&& func, Args&&... args) {
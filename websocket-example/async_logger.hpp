@@ -0,0 +1,492 @@
+//
+// 异步日志
+// 每个线程把二进制记录写入自己的无锁环形缓冲区，由后台线程统一格式化并输出。
+// 记录只保存格式字符串指针和参数的原始值，格式化推迟到后台线程；
+// 缓冲区满时丢弃记录并计数，写日志的线程不会加锁、不会阻塞，也不会访问终端。
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+// 编译期的最低日志级别，低于它的日志调用连同参数求值一起被编译器删除
+// 0=trace 1=debug 2=info 3=warn 4=error 5=off
+#ifndef WS_LOG_COMPILE_LEVEL
+#define WS_LOG_COMPILE_LEVEL 1
+#endif
+
+// 每个线程的环形缓冲区能容纳的记录数，必须是2的幂
+#ifndef WS_LOG_RING_CAPACITY
+#define WS_LOG_RING_CAPACITY 4096
+#endif
+
+namespace logging {
+
+enum class level : std::uint8_t
+{
+    trace = 0,
+    debug,
+    info,
+    warn,
+    error,
+    off
+};
+
+inline char const* level_name(level l)
+{
+    static char const* const names[] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR", "OFF  "};
+    return names[static_cast<int>(l)];
+}
+
+// 解析级别名称，无法识别时返回fallback
+inline level parse_level(char const* name, level fallback)
+{
+    static char const* const names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    if(name)
+    {
+        for(int i = 0; i < 6; ++i)
+        {
+            if(std::strcmp(name, names[i]) == 0)
+                return static_cast<level>(i);
+        }
+    }
+    return fallback;
+}
+
+// 字符串参数在记录文本区中的位置
+struct text_ref
+{
+    std::uint16_t offset;
+    std::uint16_t length;
+};
+
+// 一个参数的原始值；字符串复制到记录末尾的文本区
+struct log_arg
+{
+    enum kind_type : std::uint8_t { i64, u64, f64, boolean, text };
+
+    kind_type kind;
+    union
+    {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        bool b;
+        text_ref s;
+    };
+};
+
+// 定长二进制记录，格式字符串必须是字符串字面量，用"{}"作为占位符
+struct record
+{
+    static constexpr std::size_t max_args = 6;
+    static constexpr std::size_t text_capacity = 160;
+
+    std::int64_t timestamp_ns;              // system_clock时间
+    char const* format;
+    level lvl;
+    std::uint8_t arg_count;
+    std::uint16_t text_used;
+    std::array<log_arg, max_args> args;
+    char text[text_capacity];               // 字符串参数的副本，超出部分被截断
+};
+
+// 单生产者单消费者的环形缓冲区，生产者是拥有它的线程，消费者是后台线程
+class ring
+{
+    static constexpr std::size_t capacity = WS_LOG_RING_CAPACITY;
+    static_assert((capacity & (capacity - 1)) == 0, "WS_LOG_RING_CAPACITY必须是2的幂");
+
+    std::unique_ptr<record[]> slots_{new record[capacity]};
+    alignas(64) std::atomic<std::size_t> head_{0};      // 只由生产者修改
+    alignas(64) std::atomic<std::size_t> tail_{0};      // 只由消费者修改
+    alignas(64) std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> abandoned_{false};
+    std::uint32_t thread_index_;
+
+public:
+    explicit ring(std::uint32_t thread_index)
+        : thread_index_(thread_index)
+    {
+    }
+
+    // 取得下一个空闲记录，缓冲区已满时计数并返回nullptr
+    record* claim()
+    {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) == capacity)
+        {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &slots_[head & (capacity - 1)];
+    }
+
+    // 发布claim()返回的记录
+    void publish()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // 由消费者调用，依次处理所有已发布的记录
+    template<class Handler>
+    std::size_t drain(Handler&& handler)
+    {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head = head_.load(std::memory_order_acquire);
+        for(std::size_t i = tail; i != head; ++i)
+            handler(slots_[i & (capacity - 1)]);
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    std::uint64_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    std::uint32_t thread_index() const
+    {
+        return thread_index_;
+    }
+
+    // 拥有它的线程已经退出，后台线程取完剩余记录后释放它
+    void abandon()
+    {
+        abandoned_.store(true, std::memory_order_release);
+    }
+
+    bool abandoned() const
+    {
+        return abandoned_.load(std::memory_order_acquire);
+    }
+};
+
+namespace detail {
+
+inline void encode(record&, log_arg& a, bool v)
+{
+    a.kind = log_arg::boolean;
+    a.b = v;
+}
+
+inline void encode(record& r, log_arg& a, std::string_view v)
+{
+    std::size_t n = std::min(v.size(), record::text_capacity - r.text_used);
+    std::memcpy(r.text + r.text_used, v.data(), n);
+    a.kind = log_arg::text;
+    a.s.offset = r.text_used;
+    a.s.length = static_cast<std::uint16_t>(n);
+    r.text_used = static_cast<std::uint16_t>(r.text_used + n);
+}
+
+inline void encode(record& r, log_arg& a, char const* v)
+{
+    encode(r, a, std::string_view(v ? v : "(null)"));
+}
+
+inline void encode(record& r, log_arg& a, std::string const& v)
+{
+    encode(r, a, std::string_view(v));
+}
+
+template<class T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type
+encode(record&, log_arg& a, T v)
+{
+    if constexpr(std::is_floating_point<T>::value)
+    {
+        a.kind = log_arg::f64;
+        a.d = static_cast<double>(v);
+    }
+    else if constexpr(std::is_signed<T>::value)
+    {
+        a.kind = log_arg::i64;
+        a.i = static_cast<std::int64_t>(v);
+    }
+    else
+    {
+        a.kind = log_arg::u64;
+        a.u = static_cast<std::uint64_t>(v);
+    }
+}
+
+inline void encode_all(record&, std::size_t)
+{
+}
+
+template<class First, class... Rest>
+void encode_all(record& r, std::size_t index, First const& first, Rest const&... rest)
+{
+    encode(r, r.args[index], first);
+    encode_all(r, index + 1, rest...);
+}
+
+inline void append_arg(std::string& out, record const& r, log_arg const& a)
+{
+    char buf[32];
+    switch(a.kind)
+    {
+    case log_arg::i64:
+        out.append(buf, std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(a.i)));
+        break;
+    case log_arg::u64:
+        out.append(buf, std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(a.u)));
+        break;
+    case log_arg::f64:
+        out.append(buf, std::snprintf(buf, sizeof(buf), "%g", a.d));
+        break;
+    case log_arg::boolean:
+        out.append(a.b ? "true" : "false");
+        break;
+    case log_arg::text:
+        out.append(r.text + a.s.offset, a.s.length);
+        break;
+    }
+}
+
+// 把一条记录格式化为一行文本
+inline void format_record(std::string& out, record const& r, std::uint32_t thread_index)
+{
+    std::time_t seconds = static_cast<std::time_t>(r.timestamp_ns / 1000000000);
+    std::tm tm;
+    localtime_r(&seconds, &tm);
+    char prefix[64];
+    std::size_t n = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm);
+    n += std::snprintf(prefix + n, sizeof(prefix) - n, ".%06lld %s [%u] ",
+                       static_cast<long long>(r.timestamp_ns % 1000000000 / 1000),
+                       level_name(r.lvl), thread_index);
+    out.append(prefix, n);
+
+    std::size_t next = 0;
+    for(char const* p = r.format; *p; ++p)
+    {
+        if(p[0] == '{' && p[1] == '}' && next < r.arg_count)
+        {
+            append_arg(out, r, r.args[next++]);
+            ++p;
+        }
+        else
+        {
+            out.push_back(*p);
+        }
+    }
+    out.push_back('\n');
+}
+
+} // namespace detail
+
+// 进程内唯一的日志器，第一次使用时启动后台线程
+// 运行时级别取自环境变量WS_LOG_LEVEL（trace/debug/info/warn/error/off），默认为info
+class logger
+{
+    struct ring_entry
+    {
+        std::shared_ptr<ring> r;
+        std::uint64_t reported_dropped = 0;
+    };
+
+    // 线程退出时通知后台线程回收它的缓冲区
+    struct thread_ring
+    {
+        std::shared_ptr<ring> r;
+
+        ~thread_ring()
+        {
+            if(r)
+                r->abandon();
+        }
+    };
+
+    std::atomic<level> level_;
+    std::atomic<int> fd_{STDOUT_FILENO};
+    std::atomic<bool> running_{true};
+    std::chrono::milliseconds flush_interval_{2};
+    std::mutex registry_mutex_;                 // 只在线程第一次写日志时和后台线程中使用
+    std::vector<std::shared_ptr<ring>> new_rings_;
+    std::uint32_t next_thread_index_ = 0;
+    std::atomic<std::uint64_t> total_dropped_{0};
+    std::thread flusher_;
+
+    logger()
+        : level_(parse_level(std::getenv("WS_LOG_LEVEL"), level::info))
+    {
+        flusher_ = std::thread([this] { run(); });
+    }
+
+public:
+    static logger& instance()
+    {
+        static logger log;
+        return log;
+    }
+
+    ~logger()
+    {
+        stop();
+    }
+
+    logger(logger const&) = delete;
+    logger& operator=(logger const&) = delete;
+
+    bool enabled(level l) const
+    {
+        return l >= level_.load(std::memory_order_relaxed);
+    }
+
+    void set_level(level l)
+    {
+        level_.store(l, std::memory_order_relaxed);
+    }
+
+    level get_level() const
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    // 输出到另一个文件描述符，默认为标准输出
+    void set_output(int fd)
+    {
+        fd_.store(fd, std::memory_order_relaxed);
+    }
+
+    // 因缓冲区满而丢弃的记录总数（只统计后台线程已经处理过的缓冲区）
+    std::uint64_t dropped() const
+    {
+        return total_dropped_.load(std::memory_order_relaxed);
+    }
+
+    template<class... Args>
+    void log(level l, char const* format, Args const&... args)
+    {
+        static_assert(sizeof...(Args) <= record::max_args, "日志参数过多");
+        ring& r = local_ring();
+        record* rec = r.claim();
+        if(!rec)
+            return;
+        rec->timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        rec->format = format;
+        rec->lvl = l;
+        rec->arg_count = static_cast<std::uint8_t>(sizeof...(Args));
+        rec->text_used = 0;
+        detail::encode_all(*rec, 0, args...);
+        r.publish();
+    }
+
+    // 输出所有剩余记录并停止后台线程，程序退出前调用
+    void stop()
+    {
+        if(running_.exchange(false) && flusher_.joinable())
+            flusher_.join();
+    }
+
+private:
+    ring& local_ring()
+    {
+        thread_local thread_ring local;
+        if(!local.r)
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            local.r = std::make_shared<ring>(next_thread_index_++);
+            new_rings_.push_back(local.r);
+        }
+        return *local.r;
+    }
+
+    void run()
+    {
+        std::vector<ring_entry> rings;
+        std::string out;
+        for(;;)
+        {
+            // 先记下是否要退出，保证退出前最后一轮能取完所有记录
+            bool stopping = !running_.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(registry_mutex_);
+                for(auto& r : new_rings_)
+                    rings.push_back({r, 0});
+                new_rings_.clear();
+            }
+
+            std::size_t drained = 0;
+            for(auto it = rings.begin(); it != rings.end();)
+            {
+                bool abandoned = it->r->abandoned();
+                std::uint32_t index = it->r->thread_index();
+                drained += it->r->drain([&](record const& rec) { detail::format_record(out, rec, index); });
+
+                std::uint64_t dropped = it->r->dropped();
+                if(dropped != it->reported_dropped)
+                {
+                    char line[96];
+                    out.append(line, std::snprintf(line, sizeof(line),
+                        "日志缓冲区已满，线程[%u]丢弃了%llu条记录\n", index,
+                        static_cast<unsigned long long>(dropped - it->reported_dropped)));
+                    total_dropped_.fetch_add(dropped - it->reported_dropped, std::memory_order_relaxed);
+                    it->reported_dropped = dropped;
+                }
+
+                // 线程已经退出且记录已取完
+                if(abandoned)
+                    it = rings.erase(it);
+                else
+                    ++it;
+            }
+
+            write_all(out);
+            out.clear();
+            if(stopping)
+                return;
+            // 没有新记录时才休眠，日志密集时连续输出以减少丢弃
+            if(drained == 0)
+                std::this_thread::sleep_for(flush_interval_);
+        }
+    }
+
+    void write_all(std::string const& out)
+    {
+        int fd = fd_.load(std::memory_order_relaxed);
+        std::size_t done = 0;
+        while(done < out.size())
+        {
+            ssize_t n = ::write(fd, out.data() + done, out.size() - done);
+            if(n <= 0)
+                return;
+            done += static_cast<std::size_t>(n);
+        }
+    }
+};
+
+} // namespace logging
+
+// 日志宏：编译期级别低于WS_LOG_COMPILE_LEVEL的调用被删除，其余在运行时按级别过滤
+#define WS_LOG(lvl, ...)                                                            \
+    do                                                                              \
+    {                                                                               \
+        if(static_cast<int>(lvl) >= WS_LOG_COMPILE_LEVEL &&                         \
+           ::logging::logger::instance().enabled(lvl))                              \
+            ::logging::logger::instance().log(lvl, __VA_ARGS__);                    \
+    } while(0)
+
+#define WS_LOG_TRACE(...) WS_LOG(::logging::level::trace, __VA_ARGS__)
+#define WS_LOG_DEBUG(...) WS_LOG(::logging::level::debug, __VA_ARGS__)
+#define WS_LOG_INFO(...) WS_LOG(::logging::level::info, __VA_ARGS__)
+#define WS_LOG_WARN(...) WS_LOG(::logging::level::warn, __VA_ARGS__)
+#define WS_LOG_ERROR(...) WS_LOG(::logging::level::error, __VA_ARGS__)
@@ -0,0 +1,155 @@
+//
+// permessage-deflate压缩配置
+// 服务器、客户端和基准测试共用的压缩参数和命令行选项
+//
+
+#pragma once
+
+#include <boost/beast/core/role.hpp>
+#include <boost/beast/websocket/option.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// permessage-deflate参数，两个方向使用相同的设置
+struct compression_options
+{
+    bool enable = false;
+    int window_bits = 15;               // LZ77窗口大小的对数，9..15，越小每个连接占用的内存越少
+    int mem_level = 8;                  // zlib内部状态的内存级别，1..9
+    int level = 6;                      // 压缩级别，0..9
+    bool no_context_takeover = false;   // 每条消息单独压缩，不保留上一条消息的字典
+    std::size_t threshold = 0;          // 小于该字节数的消息不压缩
+};
+
+namespace compression_detail {
+
+// Boost 1.74的permessage_deflate没有msg_size_threshold，新版本才有
+template<class T, class = void>
+struct has_msg_size_threshold : std::false_type
+{
+};
+
+template<class T>
+struct has_msg_size_threshold<T, std::void_t<decltype(std::declval<T&>().msg_size_threshold)>>
+    : std::true_type
+{
+};
+
+template<class T>
+void set_msg_size_threshold(T& pmd, std::size_t threshold)
+{
+    if constexpr(has_msg_size_threshold<T>::value)
+        pmd.msg_size_threshold = threshold;
+    else
+        (void)pmd, (void)threshold;
+}
+
+inline bool parse_int(char const* text, int min, int max, int& value)
+{
+    char* end = nullptr;
+    long v = std::strtol(text, &end, 10);
+    if(end == text || *end != '\0' || v < min || v > max)
+        return false;
+    value = static_cast<int>(v);
+    return true;
+}
+
+} // namespace compression_detail
+
+// 当前的Beast是否支持压缩阈值；不支持时所有消息都会压缩
+constexpr bool compression_threshold_supported =
+    compression_detail::has_msg_size_threshold<boost::beast::websocket::permessage_deflate>::value;
+
+// 按角色生成握手时提供的permessage-deflate选项
+inline boost::beast::websocket::permessage_deflate make_permessage_deflate(
+    compression_options const& options,
+    boost::beast::role_type role)
+{
+    boost::beast::websocket::permessage_deflate pmd;
+    pmd.server_enable = options.enable && role == boost::beast::role_type::server;
+    pmd.client_enable = options.enable && role == boost::beast::role_type::client;
+    // zlib的问题导致窗口不能小于9
+    pmd.server_max_window_bits = std::clamp(options.window_bits, 9, 15);
+    pmd.client_max_window_bits = pmd.server_max_window_bits;
+    pmd.server_no_context_takeover = options.no_context_takeover;
+    pmd.client_no_context_takeover = options.no_context_takeover;
+    pmd.compLevel = std::clamp(options.level, 0, 9);
+    pmd.memLevel = std::clamp(options.mem_level, 1, 9);
+    compression_detail::set_msg_size_threshold(pmd, options.threshold);
+    return pmd;
+}
+
+// 用于日志和基准测试输出的简短描述
+inline std::string describe(compression_options const& options)
+{
+    if(!options.enable)
+        return "off";
+    std::string text = "wb" + std::to_string(options.window_bits) +
+        " mem" + std::to_string(options.mem_level) +
+        " lvl" + std::to_string(options.level);
+    if(options.no_context_takeover)
+        text += " nctx";
+    if(options.threshold > 0)
+        text += " >=" + std::to_string(options.threshold);
+    return text;
+}
+
+// 解析argv[i]开始的一个压缩选项
+// 返回消耗的参数个数；argv[i]不是压缩选项时返回0，值无效时返回-1。
+// 除--threshold以外的任何压缩选项都会启用压缩。
+inline int parse_compression_arg(int argc, char* argv[], int i, compression_options& options)
+{
+    using compression_detail::parse_int;
+    char const* arg = argv[i];
+    char const* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if(std::strcmp(arg, "--deflate") == 0)
+    {
+        options.enable = true;
+        return 1;
+    }
+    if(std::strcmp(arg, "--no-context-takeover") == 0)
+    {
+        options.enable = true;
+        options.no_context_takeover = true;
+        return 1;
+    }
+    if(std::strcmp(arg, "--window-bits") == 0)
+    {
+        options.enable = true;
+        return value && parse_int(value, 9, 15, options.window_bits) ? 2 : -1;
+    }
+    if(std::strcmp(arg, "--mem-level") == 0)
+    {
+        options.enable = true;
+        return value && parse_int(value, 1, 9, options.mem_level) ? 2 : -1;
+    }
+    if(std::strcmp(arg, "--level") == 0)
+    {
+        options.enable = true;
+        return value && parse_int(value, 0, 9, options.level) ? 2 : -1;
+    }
+    if(std::strcmp(arg, "--threshold") == 0)
+    {
+        int threshold = 0;
+        if(!value || !parse_int(value, 0, 1 << 30, threshold))
+            return -1;
+        options.threshold = static_cast<std::size_t>(threshold);
+        return 2;
+    }
+    return 0;
+}
+
+// 命令行帮助中的压缩选项说明
+constexpr char compression_usage[] =
+    "  --deflate                启用permessage-deflate\n"
+    "  --window-bits N          窗口大小的对数，9..15（默认15）\n"
+    "  --mem-level N            zlib内存级别，1..9（默认8）\n"
+    "  --level N                压缩级别，0..9（默认6）\n"
+    "  --no-context-takeover    每条消息单独压缩\n"
+    "  --threshold B            小于B字节的消息不压缩（需要Beast支持msg_size_threshold）\n";
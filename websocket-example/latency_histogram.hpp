@@ -0,0 +1,140 @@
+//
+// 延迟直方图
+// HDR风格的对数线性分桶，记录是O(1)的数组下标计算，直方图之间可以直接合并
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// 以纳秒为单位记录延迟
+// 小于128ns的值每纳秒一个桶；更大的值在每个2的幂区间内平均分成64个桶，
+// 相对误差不超过1/64，与数值的大小无关。
+class latency_histogram
+{
+    static constexpr int sub_bits = 6;
+    static constexpr std::size_t sub_count = std::size_t(1) << sub_bits;            // 每个区间的桶数
+    static constexpr std::size_t linear_count = 2 * sub_count;                      // 线性部分的桶数
+    static constexpr std::size_t bucket_count = linear_count + (63 - sub_bits) * sub_count;
+
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t total_ = 0;
+    std::uint64_t min_ = (std::numeric_limits<std::uint64_t>::max)();
+    std::uint64_t max_ = 0;
+    double sum_ = 0;
+
+    static std::size_t index_of(std::uint64_t value)
+    {
+        if(value < linear_count)
+            return static_cast<std::size_t>(value);
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - sub_bits;
+        std::size_t mantissa = static_cast<std::size_t>(value >> shift);    // [sub_count, 2*sub_count)
+        return linear_count + (msb - sub_bits - 1) * sub_count + (mantissa - sub_count);
+    }
+
+    static std::uint64_t lower_bound_of(std::size_t index)
+    {
+        if(index < linear_count)
+            return index;
+        std::size_t k = index - linear_count;
+        int shift = static_cast<int>(k / sub_count) + 1;
+        return static_cast<std::uint64_t>(sub_count + k % sub_count) << shift;
+    }
+
+    static std::uint64_t upper_bound_of(std::size_t index)
+    {
+        if(index < linear_count)
+            return index;
+        std::size_t k = index - linear_count;
+        int shift = static_cast<int>(k / sub_count) + 1;
+        return lower_bound_of(index) + ((std::uint64_t(1) << shift) - 1);
+    }
+
+public:
+    latency_histogram()
+        : counts_(bucket_count)
+    {
+    }
+
+    void record(std::uint64_t ns)
+    {
+        ++counts_[index_of(ns)];
+        ++total_;
+        min_ = std::min(min_, ns);
+        max_ = std::max(max_, ns);
+        sum_ += static_cast<double>(ns);
+    }
+
+    void merge(latency_histogram const& other)
+    {
+        for(std::size_t i = 0; i < bucket_count; ++i)
+            counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        min_ = (std::numeric_limits<std::uint64_t>::max)();
+        max_ = 0;
+        sum_ = 0;
+    }
+
+    std::uint64_t count() const
+    {
+        return total_;
+    }
+
+    std::uint64_t min() const
+    {
+        return total_ ? min_ : 0;
+    }
+
+    std::uint64_t max() const
+    {
+        return max_;
+    }
+
+    double mean() const
+    {
+        return total_ ? sum_ / total_ : 0;
+    }
+
+    // 分位数p（0..1）处的值，取所在桶的上界并且不超过最大值
+    std::uint64_t percentile(double p) const
+    {
+        if(total_ == 0)
+            return 0;
+        auto target = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * total_));
+        target = std::max<std::uint64_t>(target, 1);
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if(seen >= target)
+                return std::min(upper_bound_of(i), max_);
+        }
+        return max_;
+    }
+
+    // 按值从小到大对每个非空桶调用f(下界, 上界, 计数)
+    template<class F>
+    void for_each_bucket(F&& f) const
+    {
+        for(std::size_t i = 0; i < bucket_count; ++i)
+        {
+            if(counts_[i])
+                f(lower_bound_of(i), upper_bound_of(i), counts_[i]);
+        }
+    }
+};
@@ -0,0 +1,630 @@
+//
+// WebSocket负载生成器
+// 多个连接分布在多个线程上向回显服务器发送消息，按发送计划测量往返延迟
+//
+
+#pragma once
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "async_logger.hpp"
+#include "compression.hpp"
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;         // from <boost/beast.hpp>
+namespace websocket = beast::websocket; // from <boost/beast/websocket.hpp>
+namespace net = boost::asio;            // from <boost/asio.hpp>
+using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+// 负载生成器配置
+struct load_options
+{
+    std::string host;
+    std::string port;
+    unsigned connections = 16;
+    unsigned threads = 1;
+    double duration = 10;               // 秒
+    double rate = 0;                    // 所有连接合计每秒发送的消息数；0表示闭环
+    unsigned pipeline = 0;              // 每个连接在途消息的上限；0表示闭环为1、开环不限
+    std::size_t payload_size = 64;
+    bool binary = false;
+    double interval = 1;                // 实时输出的间隔秒数
+    std::string json_path = "load_result.json";     // "-"表示输出到标准输出
+    compression_options compression;
+};
+
+using load_clock = std::chrono::steady_clock;
+
+// 一个线程在一个间隔内的统计
+struct load_snapshot
+{
+    latency_histogram latency;
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t in_flight = 0;
+};
+
+class load_connection;
+
+// 每个线程一个io_context，连接只在所属的线程上运行，统计不需要同步
+struct load_worker
+{
+    net::io_context ioc{1};
+    net::executor_work_guard<net::io_context::executor_type> work{ioc.get_executor()};
+    std::vector<std::shared_ptr<load_connection>> connections;
+    load_snapshot interval;
+    latency_histogram total;
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+    std::uint64_t errors = 0;
+    std::thread thread;
+
+    // 取出本间隔的统计并清零，在worker的线程上调用
+    load_snapshot take_interval();
+};
+
+// 负载连接
+// 开环模式按固定间隔安排消息，闭环模式收到一条回显才安排下一条；
+// 延迟从安排的时间算起，消息因为在途上限或写操作排队而推迟发送时，等待的时间也计入延迟。
+// 服务器按顺序回显，所以回显和安排的时间按先进先出对应。
+class load_connection : public std::enable_shared_from_this<load_connection>
+{
+    using socket_type = net::basic_stream_socket<tcp, net::io_context::executor_type>;
+    using timer_type = net::basic_waitable_timer<
+        load_clock, net::wait_traits<load_clock>, net::io_context::executor_type>;
+
+    static constexpr std::size_t max_catch_up = 256;    // 定时器每次最多补发的消息数
+
+    load_worker& worker_;
+    load_options const& options_;
+    std::string const& payload_;
+    websocket::stream<socket_type> ws_;
+    timer_type timer_;
+    beast::flat_buffer buffer_;
+    std::deque<load_clock::time_point> scheduled_;  // 还没有收到回显的消息的安排时间
+    std::size_t unsent_ = 0;                        // scheduled_末尾还没有开始写的消息数
+    load_clock::duration period_{};
+    load_clock::time_point next_;
+    bool writing_ = false;
+    bool running_ = false;
+    bool closing_ = false;
+
+public:
+    load_connection(load_worker& worker, load_options const& options, std::string const& payload)
+        : worker_(worker)
+        , options_(options)
+        , payload_(payload)
+        , ws_(worker.ioc.get_executor())
+        , timer_(worker.ioc.get_executor())
+    {
+        ws_.set_option(make_permessage_deflate(options.compression, beast::role_type::client));
+        ws_.binary(options.binary);
+    }
+
+    // 连接并握手，完成后调用done(是否成功)
+    template<class Done>
+    void connect(tcp::resolver::results_type const& results, Done done)
+    {
+        auto self = shared_from_this();
+        net::async_connect(
+            ws_.next_layer(),
+            results,
+            [this, self, done](beast::error_code ec, tcp::endpoint const&)
+            {
+                if(ec)
+                {
+                    WS_LOG_ERROR("连接失败: {}", ec.message());
+                    done(false);
+                    return;
+                }
+                ws_.next_layer().set_option(tcp::no_delay(true), ec);
+                ws_.async_handshake(options_.host, "/",
+                    [this, self, done](beast::error_code ec)
+                    {
+                        if(ec)
+                            WS_LOG_ERROR("握手失败: {}", ec.message());
+                        done(!ec);
+                    });
+            });
+    }
+
+    // 开始发送，phase是开环模式下第一条消息相对start的偏移比例，用来错开各连接的发送时刻
+    void start(load_clock::time_point start, double phase)
+    {
+        running_ = true;
+        do_read();
+        if(options_.rate > 0)
+        {
+            // 速率高到间隔不足一个时钟单位时按一个单位处理，间隔为0时on_timer的补发循环不会结束
+            period_ = std::max(load_clock::duration(1), std::chrono::duration_cast<load_clock::duration>(
+                std::chrono::duration<double>(options_.connections / options_.rate)));
+            next_ = start + std::chrono::duration_cast<load_clock::duration>(period_ * phase);
+            arm_timer();
+        }
+        else
+        {
+            unsigned depth = options_.pipeline ? options_.pipeline : 1;
+            auto now = load_clock::now();
+            for(unsigned i = 0; i < depth; ++i)
+                schedule(now);
+        }
+    }
+
+    // 停止安排新消息，丢弃还没有写出的消息，当前的写完成后关闭连接
+    void stop()
+    {
+        running_ = false;
+        beast::error_code ec;
+        timer_.cancel(ec);
+        scheduled_.resize(scheduled_.size() - unsent_);
+        unsent_ = 0;
+        if(!writing_)
+            close();
+    }
+
+    std::size_t in_flight() const
+    {
+        return scheduled_.size() - unsent_;
+    }
+
+private:
+    void arm_timer()
+    {
+        timer_.expires_at(next_);
+        timer_.async_wait(
+            beast::bind_front_handler(
+                &load_connection::on_timer,
+                shared_from_this()));
+    }
+
+    void on_timer(beast::error_code ec)
+    {
+        if(ec || !running_)
+            return;
+
+        // 线程来不及时补上到期的消息，保持计划的速率。
+        // 每次最多补max_catch_up条，剩下的由立即到期的定时器继续补，
+        // 补发慢于速率时读写和停止的处理函数仍然能插进来执行
+        auto now = load_clock::now();
+        for(std::size_t n = 0; next_ <= now && n < max_catch_up; ++n)
+        {
+            schedule(next_);
+            next_ += period_;
+        }
+        arm_timer();
+    }
+
+    void schedule(load_clock::time_point when)
+    {
+        scheduled_.push_back(when);
+        ++unsent_;
+        do_write();
+    }
+
+    void do_write()
+    {
+        if(writing_ || unsent_ == 0)
+            return;
+        if(options_.pipeline && in_flight() >= options_.pipeline)
+            return;
+
+        // 写出的消息从开始写时就算作在途，回显不会早于它被计入
+        writing_ = true;
+        --unsent_;
+        ws_.async_write(
+            net::buffer(payload_),
+            beast::bind_front_handler(
+                &load_connection::on_write,
+                shared_from_this()));
+    }
+
+    void on_write(beast::error_code ec, std::size_t)
+    {
+        writing_ = false;
+        if(ec)
+        {
+            fail(ec);
+            return;
+        }
+        if(!running_)
+        {
+            close();
+            return;
+        }
+        ++worker_.sent;
+        ++worker_.interval.sent;
+        do_write();
+    }
+
+    void do_read()
+    {
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &load_connection::on_read,
+                shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+        {
+            if(running_)
+                fail(ec);
+            return;
+        }
+        buffer_.consume(buffer_.size());
+
+        if(in_flight() > 0)
+        {
+            auto now = load_clock::now();
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - scheduled_.front());
+            scheduled_.pop_front();
+            if(running_)
+            {
+                auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+                worker_.interval.latency.record(ns);
+                worker_.total.record(ns);
+                ++worker_.received;
+                ++worker_.interval.received;
+                if(options_.rate <= 0)
+                    schedule(now);
+                else
+                    do_write();
+            }
+        }
+        do_read();
+    }
+
+    void fail(beast::error_code ec)
+    {
+        if(!running_)
+            return;
+        WS_LOG_ERROR("连接出错: {}", ec.message());
+        ++worker_.errors;
+        ++worker_.interval.errors;
+        running_ = false;
+        beast::error_code ignored;
+        timer_.cancel(ignored);
+        ws_.next_layer().close(ignored);
+    }
+
+    void close()
+    {
+        if(closing_)
+            return;
+        closing_ = true;
+        ws_.async_close(websocket::close_code::normal,
+            [self = shared_from_this()](beast::error_code) {});
+    }
+};
+
+inline load_snapshot load_worker::take_interval()
+{
+    load_snapshot snapshot = std::move(interval);
+    interval = load_snapshot();
+    for(auto const& c : connections)
+        snapshot.in_flight += c->in_flight();
+    return snapshot;
+}
+
+// 把纳秒格式化为带单位的字符串
+inline std::string format_latency(std::uint64_t ns)
+{
+    char text[32];
+    if(ns < 1000)
+        std::snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(ns));
+    else if(ns < 1000000)
+        std::snprintf(text, sizeof(text), "%.1fus", ns / 1e3);
+    else if(ns < 1000000000)
+        std::snprintf(text, sizeof(text), "%.2fms", ns / 1e6);
+    else
+        std::snprintf(text, sizeof(text), "%.2fs", ns / 1e9);
+    return text;
+}
+
+// 运行负载测试的协调者：建立连接、启动发送、定期汇总各线程的统计并输出
+class load_generator
+{
+    load_options options_;
+    std::string payload_;
+    std::vector<std::unique_ptr<load_worker>> workers_;
+
+public:
+    explicit load_generator(load_options options)
+        : options_(std::move(options))
+    {
+        options_.threads = std::max(1u, options_.threads);
+        // 文本帧必须是有效的UTF-8，二进制帧使用不重复的字节模式
+        payload_.resize(options_.payload_size);
+        for(std::size_t i = 0; i < payload_.size(); ++i)
+            payload_[i] = options_.binary ? static_cast<char>(i * 131 + 7) : static_cast<char>('a' + i % 26);
+    }
+
+    int run()
+    {
+        tcp::resolver::results_type results;
+        {
+            net::io_context ioc;
+            tcp::resolver resolver(ioc);
+            beast::error_code ec;
+            results = resolver.resolve(options_.host, options_.port, ec);
+            if(ec)
+            {
+                WS_LOG_ERROR("解析失败: {}", ec.message());
+                return EXIT_FAILURE;
+            }
+        }
+
+        for(unsigned t = 0; t < options_.threads; ++t)
+            workers_.push_back(std::make_unique<load_worker>());
+        for(unsigned i = 0; i < options_.connections; ++i)
+        {
+            auto& w = *workers_[i % options_.threads];
+            w.connections.push_back(std::make_shared<load_connection>(w, options_, payload_));
+        }
+        for(auto& w : workers_)
+        {
+            load_worker* worker = w.get();
+            worker->thread = std::thread([worker] { worker->ioc.run(); });
+        }
+
+        if(!connect_all(results))
+        {
+            shutdown();
+            return EXIT_FAILURE;
+        }
+
+        char mode[64];
+        if(options_.rate > 0)
+            std::snprintf(mode, sizeof(mode), "开环 %.0f 条/秒", options_.rate);
+        else
+            std::snprintf(mode, sizeof(mode), "闭环");
+        std::cout << "连接数: " << options_.connections << ", 线程数: " << options_.threads
+                  << ", 模式: " << mode
+                  << ", 在途上限: " << (options_.pipeline ? std::to_string(options_.pipeline) : std::string(options_.rate > 0 ? "不限" : "1"))
+                  << ", 消息: " << options_.payload_size << " 字节" << (options_.binary ? "二进制" : "文本")
+                  << ", 压缩: " << describe(options_.compression) << std::endl;
+
+        auto start = load_clock::now() + std::chrono::milliseconds(10);
+        for_each_worker([this, start](load_worker& w)
+        {
+            for(std::size_t i = 0; i < w.connections.size(); ++i)
+            {
+                double phase = static_cast<double>(i * options_.threads) / options_.connections;
+                w.connections[i]->start(start, phase);
+            }
+        });
+
+        auto end = start + std::chrono::duration_cast<load_clock::duration>(std::chrono::duration<double>(options_.duration));
+        auto interval = std::chrono::duration_cast<load_clock::duration>(std::chrono::duration<double>(options_.interval));
+        auto last = start;
+        while(true)
+        {
+            auto next = std::min(last + interval, end);
+            std::this_thread::sleep_until(next);
+            print_interval(collect(), next - last, next - start);
+            last = next;
+            if(next >= end)
+                break;
+        }
+
+        // 停止发送，最后一个间隔的统计在上面已经输出
+        for_each_worker([](load_worker& w)
+        {
+            for(auto& c : w.connections)
+                c->stop();
+        });
+        double elapsed = std::chrono::duration<double>(end - start).count();
+        shutdown();
+        return report(elapsed);
+    }
+
+private:
+    // 在每个worker的线程上执行f并等待全部完成
+    template<class F>
+    void for_each_worker(F f)
+    {
+        std::vector<std::future<void>> done;
+        for(auto& w : workers_)
+        {
+            auto task = std::make_shared<std::packaged_task<void()>>([&f, worker = w.get()] { f(*worker); });
+            done.push_back(task->get_future());
+            net::post(w->ioc, [task] { (*task)(); });
+        }
+        for(auto& d : done)
+            d.wait();
+    }
+
+    bool connect_all(tcp::resolver::results_type const& results)
+    {
+        std::atomic<unsigned> connected{0};
+        std::atomic<unsigned> failed{0};
+        for_each_worker([&](load_worker& w)
+        {
+            for(auto& c : w.connections)
+            {
+                c->connect(results, [&connected, &failed](bool ok)
+                {
+                    (ok ? connected : failed).fetch_add(1);
+                });
+            }
+        });
+        while(connected + failed < options_.connections)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if(failed > 0)
+        {
+            WS_LOG_ERROR("{} 个连接失败", failed.load());
+            return false;
+        }
+        return true;
+    }
+
+    load_snapshot collect()
+    {
+        std::vector<load_snapshot> parts(workers_.size());
+        std::vector<std::future<void>> done;
+        for(std::size_t i = 0; i < workers_.size(); ++i)
+        {
+            auto task = std::make_shared<std::packaged_task<void()>>(
+                [&parts, i, worker = workers_[i].get()] { parts[i] = worker->take_interval(); });
+            done.push_back(task->get_future());
+            net::post(workers_[i]->ioc, [task] { (*task)(); });
+        }
+        for(auto& d : done)
+            d.wait();
+
+        load_snapshot sum;
+        for(auto const& p : parts)
+        {
+            sum.latency.merge(p.latency);
+            sum.sent += p.sent;
+            sum.received += p.received;
+            sum.errors += p.errors;
+            sum.in_flight += p.in_flight;
+        }
+        return sum;
+    }
+
+    void print_interval(load_snapshot const& s, load_clock::duration length, load_clock::duration since_start)
+    {
+        double seconds = std::chrono::duration<double>(length).count();
+        if(seconds <= 0)
+            return;
+        char line[256];
+        std::snprintf(line, sizeof(line),
+            "[%6.1fs] 发送 %9.0f/s  接收 %9.0f/s  p50 %9s  p99 %9s  p99.9 %9s  max %9s  在途 %llu  错误 %llu",
+            std::chrono::duration<double>(since_start).count(),
+            s.sent / seconds, s.received / seconds,
+            format_latency(s.latency.percentile(0.5)).c_str(),
+            format_latency(s.latency.percentile(0.99)).c_str(),
+            format_latency(s.latency.percentile(0.999)).c_str(),
+            format_latency(s.latency.max()).c_str(),
+            static_cast<unsigned long long>(s.in_flight),
+            static_cast<unsigned long long>(s.errors));
+        std::cout << line << std::endl;
+    }
+
+    // 等待连接关闭后停止所有线程，最多等1秒
+    void shutdown()
+    {
+        for(auto& w : workers_)
+            net::post(w->ioc, [worker = w.get()] { worker->work.reset(); });
+        auto deadline = load_clock::now() + std::chrono::seconds(1);
+        for(auto& w : workers_)
+        {
+            while(!w->ioc.stopped() && load_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            w->ioc.stop();
+            if(w->thread.joinable())
+                w->thread.join();
+        }
+    }
+
+    int report(double elapsed)
+    {
+        latency_histogram total;
+        std::uint64_t sent = 0;
+        std::uint64_t received = 0;
+        std::uint64_t errors = 0;
+        for(auto const& w : workers_)
+        {
+            total.merge(w->total);
+            sent += w->sent;
+            received += w->received;
+            errors += w->errors;
+        }
+        double throughput = elapsed > 0 ? received / elapsed : 0;
+
+        std::cout << "\n总计: 发送 " << sent << ", 接收 " << received << ", 错误 " << errors
+                  << ", 吞吐 " << static_cast<std::uint64_t>(throughput) << " 条/秒\n"
+                  << "延迟: min " << format_latency(total.min())
+                  << "  mean " << format_latency(static_cast<std::uint64_t>(total.mean()))
+                  << "  p50 " << format_latency(total.percentile(0.5))
+                  << "  p90 " << format_latency(total.percentile(0.9))
+                  << "  p99 " << format_latency(total.percentile(0.99))
+                  << "  p99.9 " << format_latency(total.percentile(0.999))
+                  << "  max " << format_latency(total.max()) << std::endl;
+
+        std::string json = to_json(total, sent, received, errors, elapsed, throughput);
+        if(options_.json_path == "-")
+        {
+            std::cout << json;
+            return EXIT_SUCCESS;
+        }
+        std::ofstream out(options_.json_path);
+        out << json;
+        if(!out)
+        {
+            WS_LOG_ERROR("写入{}失败", options_.json_path);
+            return EXIT_FAILURE;
+        }
+        std::cout << "结果已写入 " << options_.json_path << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::string to_json(latency_histogram const& total, std::uint64_t sent, std::uint64_t received,
+                        std::uint64_t errors, double elapsed, double throughput) const
+    {
+        auto us = [](double ns)
+        {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.3f", ns / 1e3);
+            return std::string(text);
+        };
+
+        std::string j = "{\n";
+        j += "  \"connections\": " + std::to_string(options_.connections) + ",\n";
+        j += "  \"threads\": " + std::to_string(options_.threads) + ",\n";
+        j += "  \"mode\": \"" + std::string(options_.rate > 0 ? "open" : "closed") + "\",\n";
+        j += "  \"rate\": " + std::to_string(options_.rate) + ",\n";
+        j += "  \"pipeline\": " + std::to_string(options_.pipeline) + ",\n";
+        j += "  \"payload_size\": " + std::to_string(options_.payload_size) + ",\n";
+        j += "  \"binary\": " + std::string(options_.binary ? "true" : "false") + ",\n";
+        j += "  \"compression\": \"" + describe(options_.compression) + "\",\n";
+        j += "  \"duration_s\": " + std::to_string(elapsed) + ",\n";
+        j += "  \"sent\": " + std::to_string(sent) + ",\n";
+        j += "  \"received\": " + std::to_string(received) + ",\n";
+        j += "  \"errors\": " + std::to_string(errors) + ",\n";
+        j += "  \"throughput\": " + std::to_string(throughput) + ",\n";
+        j += "  \"latency_us\": {";
+        j += "\"min\": " + us(total.min());
+        j += ", \"mean\": " + us(total.mean());
+        j += ", \"p50\": " + us(total.percentile(0.5));
+        j += ", \"p90\": " + us(total.percentile(0.9));
+        j += ", \"p99\": " + us(total.percentile(0.99));
+        j += ", \"p99_9\": " + us(total.percentile(0.999));
+        j += ", \"max\": " + us(total.max()) + "},\n";
+
+        // 非空的桶：[下界, 上界, 计数]，单位微秒
+        j += "  \"histogram_us\": [";
+        bool first = true;
+        total.for_each_bucket([&](std::uint64_t lower, std::uint64_t upper, std::uint64_t count)
+        {
+            j += first ? "\n    [" : ",\n    [";
+            j += us(lower) + ", " + us(upper) + ", " + std::to_string(count) + "]";
+            first = false;
+        });
+        j += first ? "]\n" : "\n  ]\n";
+        j += "}\n";
+        return j;
+    }
+};
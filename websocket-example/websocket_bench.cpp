@@ -0,0 +1,1199 @@
+//
+// WebSocket服务器基准测试
+// 在同一进程中启动服务器和回显客户端，测量不同配置下的性能
+//
+
+#include "websocket_server.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sys/resource.h>
+
+namespace {
+
+// 堆分配计数，用于alloc模式；thread_local计数用来区分客户端线程和服务器线程的分配
+std::atomic<std::uint64_t> g_allocations{0};
+thread_local std::uint64_t t_allocations = 0;
+
+void* counted_alloc(std::size_t size, std::size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    ++t_allocations;
+    void* p = nullptr;
+    if(alignment <= alignof(std::max_align_t))
+        p = std::malloc(size ? size : 1);
+    else if(posix_memalign(&p, alignment, size ? size : 1) != 0)
+        p = nullptr;
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+// 闭环回显连接：收到回显后立即发送下一条消息
+class echo_connection : public std::enable_shared_from_this<echo_connection>
+{
+    websocket::stream<session_socket> ws_;
+    beast::flat_buffer buffer_;
+    std::string payload_;
+    std::atomic<std::uint64_t> messages_{0};
+
+public:
+    echo_connection(net::io_context& ioc, std::size_t payload_size)
+        : ws_(net::make_strand(ioc))
+        , payload_(payload_size, 'x')
+    {
+    }
+
+    // 同步连接并完成握手，在计时开始之前调用
+    bool connect(tcp::endpoint const& endpoint)
+    {
+        beast::error_code ec;
+        ws_.next_layer().connect(endpoint, ec);
+        if(!ec)
+            ws_.next_layer().set_option(tcp::no_delay(true), ec);
+        if(!ec)
+            ws_.handshake(endpoint.address().to_string(), "/", ec);
+        if(ec)
+        {
+            std::cerr << "连接失败: " << ec.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void start()
+    {
+        net::dispatch(ws_.get_executor(),
+            beast::bind_front_handler(
+                &echo_connection::do_write,
+                shared_from_this()));
+    }
+
+    std::uint64_t messages() const
+    {
+        return messages_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void do_write()
+    {
+        ws_.async_write(
+            net::buffer(payload_),
+            beast::bind_front_handler(
+                &echo_connection::on_write,
+                shared_from_this()));
+    }
+
+    void on_write(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+            return;
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &echo_connection::on_read,
+                shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+            return;
+        buffer_.consume(buffer_.size());
+        messages_.fetch_add(1, std::memory_order_relaxed);
+        do_write();
+    }
+};
+
+struct scaling_options
+{
+    unsigned connections = 64;
+    double seconds = 3;
+    std::size_t payload_size = 64;
+    unsigned max_threads = 0;       // 0表示硬件并发数
+    unsigned client_threads = 0;    // 0表示硬件并发数
+    std::vector<io_model> models{io_model::shared, io_model::reuseport};
+};
+
+// 启动服务器，用connections个闭环连接压测seconds秒，返回每秒回显的消息数
+double measure_echo_rate(server_options const& server_opts, scaling_options const& opts)
+{
+    server srv(server_opts);
+    if(!srv.start())
+        return -1;
+
+    net::io_context client_ioc;
+    auto work = net::make_work_guard(client_ioc);
+    tcp::endpoint endpoint{net::ip::make_address("127.0.0.1"), srv.port()};
+    std::vector<std::shared_ptr<echo_connection>> connections;
+    for(unsigned i = 0; i < opts.connections; ++i)
+    {
+        auto c = std::make_shared<echo_connection>(client_ioc, opts.payload_size);
+        if(!c->connect(endpoint))
+            return -1;
+        connections.push_back(c);
+    }
+
+    unsigned client_threads = opts.client_threads ? opts.client_threads
+                                                  : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i < client_threads; ++i)
+        threads.emplace_back([&client_ioc] { client_ioc.run(); });
+    for(auto& c : connections)
+        c->start();
+
+    auto total = [&connections]
+    {
+        std::uint64_t sum = 0;
+        for(auto& c : connections)
+            sum += c->messages();
+        return sum;
+    };
+
+    // 先预热一小段时间再开始计数
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::uint64_t begin_count = total();
+    auto begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.seconds));
+    std::uint64_t end_count = total();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // 先停止服务器，客户端的连接随io_context一起销毁，不会产生错误输出
+    srv.stop();
+    srv.join();
+    client_ioc.stop();
+    for(auto& t : threads)
+        t.join();
+
+    return (end_count - begin_count) / elapsed;
+}
+
+const char* model_name(io_model model)
+{
+    return model == io_model::reuseport ? "reuseport" : "shared";
+}
+
+int run_scaling(scaling_options const& opts)
+{
+    unsigned max_threads = opts.max_threads ? opts.max_threads
+                                            : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> thread_counts;
+    for(unsigned t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << "连接数: " << opts.connections << ", 消息大小: " << opts.payload_size
+              << " 字节, 每项 " << opts.seconds << " 秒, CPU数: " << std::thread::hardware_concurrency() << "\n\n";
+    std::cout << std::left << std::setw(12) << "model" << std::right << std::setw(10) << "threads"
+              << std::setw(16) << "msgs/s" << std::setw(10) << "speedup" << std::endl;
+
+    for(io_model model : opts.models)
+    {
+        double baseline = 0;
+        for(unsigned threads : thread_counts)
+        {
+            server_options server_opts;
+            server_opts.address = net::ip::make_address("127.0.0.1");
+            server_opts.port = 0;
+            server_opts.threads = threads;
+            server_opts.model = model;
+            server_opts.pin_threads = model == io_model::reuseport;
+
+            double rate = measure_echo_rate(server_opts, opts);
+            if(rate < 0)
+                return EXIT_FAILURE;
+            if(baseline == 0)
+                baseline = rate;
+            std::cout << std::left << std::setw(12) << model_name(model) << std::right << std::setw(10) << threads
+                      << std::setw(16) << std::fixed << std::setprecision(0) << rate
+                      << std::setw(9) << std::setprecision(2) << (baseline > 0 ? rate / baseline : 0) << "x" << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+struct alloc_options
+{
+    unsigned connections = 16;
+    double seconds = 2;
+    std::size_t payload_size = 64;
+};
+
+// 单线程服务器回显时每条消息的堆分配次数
+// 客户端只在主线程上运行，其余线程（服务器和日志）的分配计为服务器的分配
+int run_alloc(alloc_options const& opts)
+{
+    server_options server_opts;
+    server_opts.address = net::ip::make_address("127.0.0.1");
+    server_opts.port = 0;
+    server_opts.threads = 1;
+    server srv(server_opts);
+    if(!srv.start())
+        return EXIT_FAILURE;
+
+    net::io_context client_ioc{1};
+    tcp::endpoint endpoint{net::ip::make_address("127.0.0.1"), srv.port()};
+    std::vector<std::shared_ptr<echo_connection>> connections;
+    for(unsigned i = 0; i < opts.connections; ++i)
+    {
+        auto c = std::make_shared<echo_connection>(client_ioc, opts.payload_size);
+        if(!c->connect(endpoint))
+            return EXIT_FAILURE;
+        connections.push_back(c);
+        c->start();
+    }
+    auto total = [&connections]
+    {
+        std::uint64_t sum = 0;
+        for(auto& c : connections)
+            sum += c->messages();
+        return sum;
+    };
+
+    // 预热期间缓冲区扩容、处理器内存缓存等一次性分配完成
+    client_ioc.run_for(std::chrono::milliseconds(300));
+    std::uint64_t begin_messages = total();
+    std::uint64_t begin_all = g_allocations.load();
+    std::uint64_t begin_client = t_allocations;
+    client_ioc.run_for(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(opts.seconds)));
+    std::uint64_t messages = total() - begin_messages;
+    std::uint64_t client = t_allocations - begin_client;
+    std::uint64_t server_side = g_allocations.load() - begin_all - client;
+
+    srv.stop();
+    srv.join();
+
+    if(messages == 0)
+    {
+        std::cerr << "没有完成任何消息" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "连接数: " << opts.connections << ", 消息大小: " << opts.payload_size
+              << " 字节, 消息数: " << messages << "\n";
+    std::cout << "服务器分配: " << server_side << " (" << std::fixed << std::setprecision(3)
+              << static_cast<double>(server_side) / messages << " 次/消息)\n";
+    std::cout << "客户端分配: " << client << " (" << static_cast<double>(client) / messages << " 次/消息)" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+bool parse_alloc_options(int argc, char* argv[], alloc_options& opts)
+{
+    try
+    {
+        for(int i = 2; i < argc; i += 2)
+        {
+            if(i + 1 >= argc)
+                return false;
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--connections")
+                opts.connections = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--seconds")
+                opts.seconds = std::stod(value);
+            else if(arg == "--size")
+                opts.payload_size = std::stoul(value);
+            else
+                return false;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    return opts.connections > 0;
+}
+
+struct fanout_options
+{
+    unsigned subscribers = 10000;
+    unsigned rounds = 50;
+    unsigned burst = 1;                 // 每轮连续发布的消息数
+    std::size_t payload_size = 64;
+    unsigned threads = 1;               // 服务器线程数
+    std::size_t queue_limit = 256;
+    overflow_policy overflow = overflow_policy::drop_oldest;
+};
+
+// 广播的订阅者：收到消息后用负载开头的发布时间计算延迟
+class fanout_subscriber : public std::enable_shared_from_this<fanout_subscriber>
+{
+    websocket::stream<session_socket> ws_;
+    beast::flat_buffer buffer_;
+    std::vector<double>& latencies_;
+    std::uint64_t& received_;
+
+public:
+    fanout_subscriber(net::io_context& ioc, std::vector<double>& latencies, std::uint64_t& received)
+        : ws_(net::make_strand(ioc))
+        , latencies_(latencies)
+        , received_(received)
+    {
+    }
+
+    // 同步连接、握手并订阅房间，等到服务器确认订阅后返回
+    bool connect(tcp::endpoint const& endpoint, std::string const& room)
+    {
+        beast::error_code ec;
+        ws_.next_layer().connect(endpoint, ec);
+        if(!ec)
+            ws_.handshake(endpoint.address().to_string(), "/", ec);
+        if(!ec && !room.empty())
+            ws_.write(net::buffer("/sub " + room), ec);
+        if(!ec && !room.empty())
+            ws_.read(buffer_, ec);
+        if(ec)
+        {
+            std::cerr << "连接失败: " << ec.message() << std::endl;
+            return false;
+        }
+        buffer_.consume(buffer_.size());
+        return true;
+    }
+
+    void write(std::string const& message)
+    {
+        ws_.write(net::buffer(message));
+    }
+
+    void start()
+    {
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &fanout_subscriber::on_read,
+                shared_from_this()));
+    }
+
+private:
+    void on_read(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+            return;
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        std::string_view payload(static_cast<char const*>(buffer_.data().data()), buffer_.size());
+        std::int64_t sent = std::stoll(std::string(payload.substr(0, payload.find(' '))));
+        latencies_.push_back(std::chrono::duration<double, std::micro>(
+            now - std::chrono::nanoseconds(sent)).count());
+        ++received_;
+        buffer_.consume(buffer_.size());
+        start();
+    }
+};
+
+// 有序样本的分位数
+double percentile(std::vector<double> const& sorted, double p)
+{
+    if(sorted.empty())
+        return 0;
+    std::size_t i = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+// 一个房间内subscribers个订阅者，另一个连接每轮发布burst条消息，
+// 测量从发布到每个订阅者收到的延迟和整轮全部送达的时间
+int run_fanout(fanout_options const& opts)
+{
+    // 客户端和服务器各需要subscribers个描述符，尽量把软限制提高到硬限制
+    rlimit limit{};
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    server_options server_opts;
+    server_opts.address = net::ip::make_address("127.0.0.1");
+    server_opts.port = 0;
+    server_opts.threads = opts.threads;
+    server_opts.write_queue_limit = opts.queue_limit;
+    server_opts.overflow = opts.overflow;
+    server srv(server_opts);
+    if(!srv.start())
+        return EXIT_FAILURE;
+
+    net::io_context client_ioc{1};
+    tcp::endpoint endpoint{net::ip::make_address("127.0.0.1"), srv.port()};
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<std::size_t>(opts.subscribers) * opts.rounds * opts.burst);
+    std::uint64_t received = 0;
+
+    std::vector<std::shared_ptr<fanout_subscriber>> subscribers;
+    for(unsigned i = 0; i < opts.subscribers; ++i)
+    {
+        auto s = std::make_shared<fanout_subscriber>(client_ioc, latencies, received);
+        if(!s->connect(endpoint, "bench"))
+        {
+            std::cerr << "已建立 " << i << " 个订阅者，可能需要提高ulimit -n" << std::endl;
+            return EXIT_FAILURE;
+        }
+        subscribers.push_back(s);
+        s->start();
+    }
+    auto publisher = std::make_shared<fanout_subscriber>(client_ioc, latencies, received);
+    if(!publisher->connect(endpoint, ""))
+        return EXIT_FAILURE;
+
+    std::vector<double> completions;
+    std::string padding(opts.payload_size, 'x');
+    auto begin = std::chrono::steady_clock::now();
+    for(unsigned round = 0; round < opts.rounds; ++round)
+    {
+        auto published = std::chrono::steady_clock::now();
+        std::uint64_t target = received + static_cast<std::uint64_t>(opts.subscribers) * opts.burst;
+        for(unsigned b = 0; b < opts.burst; ++b)
+        {
+            std::string message = "/pub bench " + std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count()) + " ";
+            if(message.size() < opts.payload_size + 11)
+                message.append(padding, 0, opts.payload_size + 11 - message.size());
+            publisher->write(message);
+        }
+
+        // 丢弃或断开时收不齐，连续500毫秒没有新消息就进入下一轮
+        auto last_progress = std::chrono::steady_clock::now();
+        std::uint64_t last_received = received;
+        while(received < target &&
+              std::chrono::steady_clock::now() - last_progress < std::chrono::milliseconds(500))
+        {
+            client_ioc.run_one_for(std::chrono::milliseconds(100));
+            if(received != last_received)
+            {
+                last_received = received;
+                last_progress = std::chrono::steady_clock::now();
+            }
+        }
+        completions.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - published).count());
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::uint64_t dropped = srv.state().dropped_frames.load();
+    std::uint64_t disconnects = srv.state().slow_disconnects.load();
+    srv.stop();
+    srv.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(completions.begin(), completions.end());
+    std::uint64_t expected = static_cast<std::uint64_t>(opts.subscribers) * opts.rounds * opts.burst;
+    std::cout << "订阅者: " << opts.subscribers << ", 轮数: " << opts.rounds << ", 每轮消息: " << opts.burst
+              << ", 消息大小: " << opts.payload_size << " 字节, 服务器线程: " << srv.threads() << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "单个订阅者延迟(us): p50 " << percentile(latencies, 0.5)
+              << "  p99 " << percentile(latencies, 0.99)
+              << "  p99.9 " << percentile(latencies, 0.999)
+              << "  max " << (latencies.empty() ? 0 : latencies.back()) << "\n";
+    std::cout << "整轮送达时间(us): p50 " << percentile(completions, 0.5)
+              << "  max " << (completions.empty() ? 0 : completions.back()) << "\n";
+    std::cout << "送达: " << latencies.size() << " / " << expected
+              << ", 服务器丢弃: " << dropped << ", 断开慢消费者: " << disconnects << "\n";
+    std::cout << "投递速率: " << std::setprecision(0) << latencies.size() / elapsed << " 条/秒" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+bool parse_fanout_options(int argc, char* argv[], fanout_options& opts)
+{
+    try
+    {
+        for(int i = 2; i < argc; i += 2)
+        {
+            if(i + 1 >= argc)
+                return false;
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--subscribers")
+                opts.subscribers = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--rounds")
+                opts.rounds = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--burst")
+                opts.burst = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--size")
+                opts.payload_size = std::stoul(value);
+            else if(arg == "--threads")
+                opts.threads = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--queue")
+                opts.queue_limit = std::stoul(value);
+            else if(arg == "--policy" && value == "drop")
+                opts.overflow = overflow_policy::drop_oldest;
+            else if(arg == "--policy" && value == "disconnect")
+                opts.overflow = overflow_policy::disconnect;
+            else
+                return false;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    return opts.subscribers > 0 && opts.rounds > 0 && opts.burst > 0;
+}
+
+struct deflate_options
+{
+    unsigned connections = 16;
+    double seconds = 2;
+    std::size_t payload_size = 1024;
+    std::string payload = "json";       // json、random或file
+    std::string file;                   // payload为file时每行一条样本
+    bool custom = false;                // 指定了压缩选项时只比较关闭压缩和该配置
+    compression_options compression;
+};
+
+// 统计basic_stream实际收发字节数的速率策略，不限制速率
+class byte_counter
+{
+    friend class beast::rate_policy_access;
+
+    std::uint64_t read_ = 0;
+    std::uint64_t written_ = 0;
+
+    std::size_t available_read_bytes() const noexcept
+    {
+        return (std::numeric_limits<std::size_t>::max)();
+    }
+
+    std::size_t available_write_bytes() const noexcept
+    {
+        return (std::numeric_limits<std::size_t>::max)();
+    }
+
+    void transfer_read_bytes(std::size_t n) noexcept
+    {
+        read_ += n;
+    }
+
+    void transfer_write_bytes(std::size_t n) noexcept
+    {
+        written_ += n;
+    }
+
+    void on_timer() noexcept
+    {
+    }
+
+public:
+    std::uint64_t bytes() const
+    {
+        return read_ + written_;
+    }
+};
+
+using counted_stream = beast::basic_stream<tcp, session_executor, byte_counter>;
+
+// 闭环回显连接，依次发送一组样本消息，统计未压缩的消息字节数和线路上的字节数
+class deflate_connection : public std::enable_shared_from_this<deflate_connection>
+{
+    websocket::stream<counted_stream> ws_;
+    beast::flat_buffer buffer_;
+    std::shared_ptr<std::vector<std::string> const> samples_;
+    std::size_t next_ = 0;
+    bool binary_;
+    std::uint64_t messages_ = 0;
+    std::uint64_t payload_bytes_ = 0;
+
+public:
+    deflate_connection(
+        net::io_context& ioc,
+        std::shared_ptr<std::vector<std::string> const> samples,
+        bool binary,
+        compression_options const& compression)
+        : ws_(net::make_strand(ioc))
+        , samples_(std::move(samples))
+        , binary_(binary)
+    {
+        ws_.set_option(make_permessage_deflate(compression, beast::role_type::client));
+    }
+
+    bool connect(tcp::endpoint const& endpoint, std::size_t offset)
+    {
+        beast::error_code ec;
+        ws_.next_layer().socket().connect(endpoint, ec);
+        if(!ec)
+            ws_.next_layer().socket().set_option(tcp::no_delay(true), ec);
+        if(!ec)
+            ws_.handshake(endpoint.address().to_string(), "/", ec);
+        if(ec)
+        {
+            std::cerr << "连接失败: " << ec.message() << std::endl;
+            return false;
+        }
+        // 各连接从不同的样本开始，避免所有连接同时发送同一条消息
+        next_ = offset % samples_->size();
+        ws_.binary(binary_);
+        return true;
+    }
+
+    void start()
+    {
+        do_write();
+    }
+
+    std::uint64_t messages() const
+    {
+        return messages_;
+    }
+
+    std::uint64_t payload_bytes() const
+    {
+        return payload_bytes_;
+    }
+
+    std::uint64_t wire_bytes()
+    {
+        return ws_.next_layer().rate_policy().bytes();
+    }
+
+private:
+    void do_write()
+    {
+        std::string const& sample = (*samples_)[next_];
+        next_ = (next_ + 1) % samples_->size();
+        payload_bytes_ += sample.size();
+        ws_.async_write(
+            net::buffer(sample),
+            beast::bind_front_handler(
+                &deflate_connection::on_write,
+                shared_from_this()));
+    }
+
+    void on_write(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+            return;
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &deflate_connection::on_read,
+                shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t)
+    {
+        if(ec)
+            return;
+        payload_bytes_ += buffer_.size();
+        buffer_.consume(buffer_.size());
+        ++messages_;
+        do_write();
+    }
+};
+
+// 生成count条互不相同、每条约size字节的JSON样本：字段名和结构重复，取值变化，接近行情和事件推送
+std::vector<std::string> make_json_samples(std::size_t size, std::size_t count)
+{
+    static char const* const events[] = {"trade", "quote", "order_update", "position_update"};
+    static char const* const symbols[] = {"AAPL", "MSFT", "GOOG", "AMZN", "TSLA", "NVDA", "META", "NFLX"};
+    std::mt19937 rng(42);
+    std::vector<std::string> samples;
+    for(std::size_t n = 0; n < count; ++n)
+    {
+        std::string s = "{\"seq\":" + std::to_string(n) + ",\"items\":[";
+        do
+        {
+            char item[256];
+            std::snprintf(item, sizeof(item),
+                "{\"id\":%u,\"event\":\"%s\",\"symbol\":\"%s\",\"price\":%u.%02u,\"qty\":%u,\"ts\":%u},",
+                static_cast<unsigned>(rng() % 1000000), events[rng() % 4], symbols[rng() % 8],
+                static_cast<unsigned>(rng() % 1000), static_cast<unsigned>(rng() % 100),
+                static_cast<unsigned>(rng() % 10000), static_cast<unsigned>(1700000000 + rng() % 1000000));
+            s += item;
+        }
+        while(s.size() + 2 < size);
+        s.back() = ']';
+        s += '}';
+        samples.push_back(std::move(s));
+    }
+    return samples;
+}
+
+// 不可压缩的随机字节，作为二进制消息发送
+std::vector<std::string> make_random_samples(std::size_t size, std::size_t count)
+{
+    std::mt19937 rng(42);
+    std::vector<std::string> samples(count, std::string(size, '\0'));
+    for(auto& s : samples)
+    {
+        for(auto& c : s)
+            c = static_cast<char>(rng());
+    }
+    return samples;
+}
+
+std::vector<std::string> load_samples(std::string const& path)
+{
+    std::vector<std::string> samples;
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(!line.empty())
+            samples.push_back(line);
+    }
+    return samples;
+}
+
+double process_cpu_seconds()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 一个连接两端的zlib状态估计占用的内存：压缩窗口和哈希表加上解压窗口
+std::size_t zlib_memory_per_side(compression_options const& c)
+{
+    if(!c.enable)
+        return 0;
+    return (std::size_t(1) << (c.window_bits + 2)) + (std::size_t(1) << (c.mem_level + 9)) +
+           (std::size_t(1) << c.window_bits);
+}
+
+struct deflate_result
+{
+    double ratio = 0;           // 线路字节数 / 未压缩的消息字节数
+    double cpu_us = 0;          // 每条消息往返消耗的进程CPU时间（两端的压缩和解压）
+    double rate = 0;            // 每秒往返的消息数
+    double raw_mbps = 0;
+    double wire_mbps = 0;
+};
+
+// 单线程服务器和主线程上的客户端都使用compression，闭环回显seconds秒
+bool measure_deflate(
+    compression_options const& compression,
+    deflate_options const& opts,
+    std::shared_ptr<std::vector<std::string> const> const& samples,
+    bool binary,
+    deflate_result& result)
+{
+    server_options server_opts;
+    server_opts.address = net::ip::make_address("127.0.0.1");
+    server_opts.port = 0;
+    server_opts.threads = 1;
+    server_opts.compression = compression;
+    server srv(server_opts);
+    if(!srv.start())
+        return false;
+
+    net::io_context client_ioc{1};
+    tcp::endpoint endpoint{net::ip::make_address("127.0.0.1"), srv.port()};
+    std::vector<std::shared_ptr<deflate_connection>> connections;
+    for(unsigned i = 0; i < opts.connections; ++i)
+    {
+        auto c = std::make_shared<deflate_connection>(client_ioc, samples, binary, compression);
+        if(!c->connect(endpoint, i * 7))
+            return false;
+        connections.push_back(c);
+        c->start();
+    }
+
+    struct totals
+    {
+        std::uint64_t messages = 0;
+        std::uint64_t payload = 0;
+        std::uint64_t wire = 0;
+    };
+    auto sum = [&connections]
+    {
+        totals t;
+        for(auto& c : connections)
+        {
+            t.messages += c->messages();
+            t.payload += c->payload_bytes();
+            t.wire += c->wire_bytes();
+        }
+        return t;
+    };
+
+    client_ioc.run_for(std::chrono::milliseconds(300));
+    totals begin = sum();
+    double cpu_begin = process_cpu_seconds();
+    auto wall_begin = std::chrono::steady_clock::now();
+    client_ioc.run_for(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(opts.seconds)));
+    totals end = sum();
+    double cpu = process_cpu_seconds() - cpu_begin;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_begin).count();
+
+    srv.stop();
+    srv.join();
+
+    std::uint64_t messages = end.messages - begin.messages;
+    std::uint64_t payload = end.payload - begin.payload;
+    std::uint64_t wire = end.wire - begin.wire;
+    if(messages == 0 || payload == 0)
+    {
+        std::cerr << "没有完成任何消息" << std::endl;
+        return false;
+    }
+    result.ratio = static_cast<double>(wire) / payload;
+    result.cpu_us = cpu * 1e6 / messages;
+    result.rate = messages / elapsed;
+    result.raw_mbps = payload / elapsed / 1e6;
+    result.wire_mbps = wire / elapsed / 1e6;
+    return true;
+}
+
+int run_deflate(deflate_options const& opts)
+{
+    std::vector<std::string> loaded;
+    bool binary = false;
+    if(opts.payload == "json")
+        loaded = make_json_samples(opts.payload_size, 64);
+    else if(opts.payload == "random")
+    {
+        loaded = make_random_samples(opts.payload_size, 64);
+        binary = true;
+    }
+    else
+        loaded = load_samples(opts.file);
+    if(loaded.empty())
+    {
+        std::cerr << "没有可用的样本消息" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::size_t sample_bytes = 0;
+    for(auto const& s : loaded)
+        sample_bytes += s.size();
+    auto samples = std::make_shared<std::vector<std::string> const>(std::move(loaded));
+
+    std::vector<compression_options> configs(1);
+    if(opts.custom)
+        configs.push_back(opts.compression);
+    else
+    {
+        // 默认配置、不保留上下文、较小的窗口和内存、最小内存和最快、最高压缩
+        configs.push_back({true, 15, 8, 6, false, 0});
+        configs.push_back({true, 15, 8, 6, true, 0});
+        configs.push_back({true, 12, 4, 6, false, 0});
+        configs.push_back({true, 9, 1, 1, false, 0});
+        configs.push_back({true, 15, 9, 9, false, 0});
+    }
+
+    std::cout << "连接数: " << opts.connections << ", 样本: " << opts.payload << " "
+              << samples->size() << " 条, 平均 " << sample_bytes / samples->size()
+              << " 字节, 每项 " << opts.seconds << " 秒\n";
+    if(opts.custom && opts.compression.threshold > 0 && !compression_threshold_supported)
+        std::cout << "注意: 当前的Beast不支持压缩阈值，所有消息都会压缩\n";
+    std::cout << "ratio为线路字节数（含帧头）与未压缩消息字节数之比，cpu为每次往返两端消耗的CPU时间\n\n";
+    std::cout << std::left << std::setw(24) << "config" << std::right << std::setw(8) << "ratio"
+              << std::setw(12) << "cpu us/msg" << std::setw(12) << "msgs/s"
+              << std::setw(11) << "raw MB/s" << std::setw(11) << "wire MB/s"
+              << std::setw(10) << "KB/conn" << std::endl;
+
+    for(auto const& config : configs)
+    {
+        deflate_result r;
+        if(!measure_deflate(config, opts, samples, binary, r))
+            return EXIT_FAILURE;
+        std::cout << std::left << std::setw(24) << describe(config) << std::right << std::fixed
+                  << std::setw(8) << std::setprecision(3) << r.ratio
+                  << std::setw(12) << std::setprecision(1) << r.cpu_us
+                  << std::setw(12) << std::setprecision(0) << r.rate
+                  << std::setw(11) << std::setprecision(1) << r.raw_mbps
+                  << std::setw(11) << r.wire_mbps
+                  << std::setw(10) << std::setprecision(0) << zlib_memory_per_side(config) / 1024.0 << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+bool parse_deflate_options(int argc, char* argv[], deflate_options& opts)
+{
+    try
+    {
+        for(int i = 2; i < argc;)
+        {
+            int used = parse_compression_arg(argc, argv, i, opts.compression);
+            if(used < 0)
+                return false;
+            if(used > 0)
+            {
+                opts.custom = true;
+                i += used;
+                continue;
+            }
+            if(i + 1 >= argc)
+                return false;
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--connections")
+                opts.connections = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--seconds")
+                opts.seconds = std::stod(value);
+            else if(arg == "--size")
+                opts.payload_size = std::stoul(value);
+            else if(arg == "--payload" && (value == "json" || value == "random"))
+                opts.payload = value;
+            else if(arg == "--file")
+            {
+                opts.payload = "file";
+                opts.file = value;
+            }
+            else
+                return false;
+            i += 2;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    // 只给了--threshold时也按启用压缩处理
+    if(opts.custom)
+        opts.compression.enable = true;
+    return opts.connections > 0 && opts.payload_size > 0;
+}
+
+struct logger_options
+{
+    unsigned threads = 4;
+    std::uint64_t records = 1000000;    // 每个线程写的日志条数
+};
+
+// 测量日志调用在调用方线程上的开销，输出重定向到/dev/null
+int run_logger(logger_options const& opts)
+{
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    if(null_fd == -1)
+    {
+        std::cerr << "打开/dev/null失败" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto& log = logging::logger::instance();
+    log.set_output(null_fd);
+    log.set_level(logging::level::debug);
+
+    std::vector<double> ns_per_call(opts.threads);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < opts.threads; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            std::string payload(48, 'x');
+            auto begin = std::chrono::steady_clock::now();
+            for(std::uint64_t i = 0; i < opts.records; ++i)
+                WS_LOG_DEBUG("收到消息: {} 序号 {} 大小 {}", payload, i, payload.size());
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            ns_per_call[t] = std::chrono::duration<double, std::nano>(elapsed).count() / opts.records;
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+    log.stop();
+    ::close(null_fd);
+
+    double sum = 0;
+    for(double ns : ns_per_call)
+        sum += ns;
+    std::uint64_t total = opts.records * opts.threads;
+    std::cout << "线程数: " << opts.threads << ", 每线程记录数: " << opts.records << "\n";
+    std::cout << "平均每次调用: " << std::fixed << std::setprecision(1) << sum / opts.threads << " ns\n";
+    std::cout << "丢弃: " << log.dropped() << " / " << total
+              << " (" << std::setprecision(2) << 100.0 * log.dropped() / total << "%)" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+bool parse_logger_options(int argc, char* argv[], logger_options& opts)
+{
+    try
+    {
+        for(int i = 2; i < argc; i += 2)
+        {
+            if(i + 1 >= argc)
+                return false;
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--threads")
+                opts.threads = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--records")
+                opts.records = std::stoull(value);
+            else
+                return false;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    return opts.threads > 0 && opts.records > 0;
+}
+
+void print_usage()
+{
+    std::cerr << "用法: websocket_bench scaling [选项]\n"
+              << "      websocket_bench alloc [--connections N] [--seconds S] [--size B]\n"
+              << "      websocket_bench fanout [选项]\n"
+              << "      websocket_bench deflate [选项]\n"
+              << "      websocket_bench logger [--threads N] [--records N]\n"
+              << "\nscaling选项:\n"
+              << "  --connections N      并发连接数（默认64）\n"
+              << "  --seconds S          每项测量的秒数（默认3）\n"
+              << "  --size B             消息大小（默认64字节）\n"
+              << "  --max-threads N      服务器线程数从1按2的幂增加到N（默认CPU数）\n"
+              << "  --client-threads N   客户端线程数（默认CPU数）\n"
+              << "  --model M            shared、reuseport或both（默认both）\n"
+              << "\nfanout选项:\n"
+              << "  --subscribers N      订阅者数（默认10000）\n"
+              << "  --rounds N           发布轮数（默认50）\n"
+              << "  --burst N            每轮连续发布的消息数（默认1）\n"
+              << "  --size B             消息大小（默认64字节）\n"
+              << "  --threads N          服务器线程数（默认1）\n"
+              << "  --queue N            每个会话的写队列上限（默认256）\n"
+              << "  --policy P           写队列满时drop或disconnect（默认drop）\n"
+              << "\ndeflate选项:\n"
+              << "  --connections N      并发连接数（默认16）\n"
+              << "  --seconds S          每项测量的秒数（默认2）\n"
+              << "  --size B             生成的样本大小（默认1024字节）\n"
+              << "  --payload P          json或random（默认json）\n"
+              << "  --file F             从文件读取样本，每行一条\n"
+              << "  不指定压缩选项时比较一组预设配置，否则只比较关闭压缩和指定的配置:\n"
+              << compression_usage;
+}
+
+// 解析"--名称 值"形式的选项，无法识别时返回false
+bool parse_scaling_options(int argc, char* argv[], scaling_options& opts)
+{
+    try
+    {
+        for(int i = 2; i < argc; i += 2)
+        {
+            if(i + 1 >= argc)
+                return false;
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--connections")
+                opts.connections = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--seconds")
+                opts.seconds = std::stod(value);
+            else if(arg == "--size")
+                opts.payload_size = std::stoul(value);
+            else if(arg == "--max-threads")
+                opts.max_threads = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--client-threads")
+                opts.client_threads = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--model" && value == "shared")
+                opts.models = {io_model::shared};
+            else if(arg == "--model" && value == "reuseport")
+                opts.models = {io_model::reuseport};
+            else if(arg == "--model" && value == "both")
+                opts.models = {io_model::shared, io_model::reuseport};
+            else
+                return false;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if(argc >= 2 && std::strcmp(argv[1], "logger") == 0)
+    {
+        logger_options opts;
+        if(!parse_logger_options(argc, argv, opts))
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        return run_logger(opts);
+    }
+
+    if(argc >= 2 && std::strcmp(argv[1], "fanout") == 0)
+    {
+        fanout_options opts;
+        if(!parse_fanout_options(argc, argv, opts))
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        logging::logger::instance().set_level(logging::level::warn);
+        int rc = run_fanout(opts);
+        logging::logger::instance().stop();
+        return rc;
+    }
+
+    if(argc >= 2 && std::strcmp(argv[1], "deflate") == 0)
+    {
+        deflate_options opts;
+        if(!parse_deflate_options(argc, argv, opts))
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        logging::logger::instance().set_level(logging::level::warn);
+        int rc = run_deflate(opts);
+        logging::logger::instance().stop();
+        return rc;
+    }
+
+    if(argc >= 2 && std::strcmp(argv[1], "alloc") == 0)
+    {
+        alloc_options opts;
+        if(!parse_alloc_options(argc, argv, opts))
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        logging::logger::instance().set_level(logging::level::warn);
+        int rc = run_alloc(opts);
+        logging::logger::instance().stop();
+        return rc;
+    }
+
+    scaling_options opts;
+    if(argc < 2 || std::strcmp(argv[1], "scaling") != 0 || !parse_scaling_options(argc, argv, opts))
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // 服务器的连接日志会干扰结果，只保留警告和错误
+    logging::logger::instance().set_level(logging::level::warn);
+    int rc = run_scaling(opts);
+    logging::logger::instance().stop();
+    return rc;
+}
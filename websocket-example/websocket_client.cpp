@@ -1,17 +1,25 @@
 //
 // WebSocket客户端示例
-// 使用Boost.Beast实现的WebSocket客户端，支持断点调试
+// 使用Boost.Beast实现的WebSocket客户端，支持断点调试；load模式作为负载生成器
 //
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
+#include <boost/asio/connect.hpp>
 #include <boost/asio/strand.hpp>
+#include "async_logger.hpp"
+#include "compression.hpp"
+#include "load_generator.hpp"
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace beast = boost::beast;         // from <boost/beast.hpp>
 namespace http = beast::http;           // from <boost/beast/http.hpp>
@@ -20,6 +28,7 @@ namespace net = boost::asio;            // from <boost/asio.hpp>
 using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
 
 // WebSocket客户端会话
+// 只发送一条消息，状态和响应都同步写到标准输出，输出顺序和事件顺序一致
 class session : public std::enable_shared_from_this<session>
 {
     tcp::resolver resolver_;
@@ -30,11 +39,14 @@ class session : public std::enable_shared_from_this<session>
 
 public:
     // 构造函数
-    explicit session(net::io_context& ioc)
+    session(net::io_context& ioc, compression_options const& compression)
         : resolver_(net::make_strand(ioc))
         , ws_(net::make_strand(ioc))
     {
         std::cout << "创建客户端会话" << std::endl;
+
+        // 服务器也启用permessage-deflate时在握手中协商压缩
+        ws_.set_option(make_permessage_deflate(compression, beast::role_type::client));
     }
 
     // 启动WebSocket会话
@@ -75,7 +87,8 @@ private:
         std::cout << "域名解析成功" << std::endl;
 
         // 连接到服务器
-        beast::get_lowest_layer(ws_).async_connect(
+        net::async_connect(
+            beast::get_lowest_layer(ws_),
             results,
             beast::bind_front_handler(
                 &session::on_connect,
@@ -183,26 +196,151 @@ private:
     }
 };
 
+namespace {
+
+void print_usage()
+{
+    std::cerr << "用法: websocket_client <主机> <端口> <消息> [压缩选项]\n"
+              << "      websocket_client load <主机> <端口> [选项] [压缩选项]\n"
+              << "示例:\n"
+              << "    websocket_client localhost 8080 \"Hello, WebSocket!\"\n"
+              << "    websocket_client localhost 8080 \"Hello, WebSocket!\" --deflate\n"
+              << "    websocket_client load localhost 8080 --connections 64 --threads 4 --duration 30\n"
+              << "    websocket_client load localhost 8080 --rate 50000 --size 256 --binary\n"
+              << "load选项:\n"
+              << "  --connections N      并发连接数（默认16）\n"
+              << "  --threads M          客户端线程数，连接平均分配到各线程（默认1）\n"
+              << "  --duration S         测试秒数（默认10）\n"
+              << "  --rate R             开环：所有连接合计每秒发送R条消息；不指定时为闭环\n"
+              << "  --pipeline D         每个连接在途消息的上限，闭环时保持D条在途（默认闭环1、开环不限）\n"
+              << "  --size B             消息大小（默认64字节）\n"
+              << "  --binary             发送二进制帧（默认文本帧）\n"
+              << "  --interval S         实时输出的间隔秒数（默认1）\n"
+              << "  --json F             结果写入的JSON文件，-表示标准输出（默认load_result.json）\n"
+              << "压缩选项:\n"
+              << compression_usage;
+}
+
+// 解析load模式的选项，argv[1]是"load"
+bool parse_load_options(int argc, char** argv, load_options& opts)
+{
+    std::vector<char*> args;
+    try
+    {
+        for(int i = 2; i < argc;)
+        {
+            int used = parse_compression_arg(argc, argv, i, opts.compression);
+            if(used < 0)
+                return false;
+            if(used > 0)
+            {
+                i += used;
+                continue;
+            }
+            std::string arg = argv[i];
+            if(arg.compare(0, 2, "--") != 0)
+            {
+                args.push_back(argv[i++]);
+                continue;
+            }
+            if(arg == "--binary")
+            {
+                opts.binary = true;
+                ++i;
+                continue;
+            }
+            if(i + 1 >= argc)
+                return false;
+            std::string value = argv[i + 1];
+            if(arg == "--connections")
+                opts.connections = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--threads")
+                opts.threads = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--duration")
+                opts.duration = std::stod(value);
+            else if(arg == "--rate")
+                opts.rate = std::stod(value);
+            else if(arg == "--pipeline")
+                opts.pipeline = static_cast<unsigned>(std::stoul(value));
+            else if(arg == "--size")
+                opts.payload_size = std::stoul(value);
+            else if(arg == "--interval")
+                opts.interval = std::stod(value);
+            else if(arg == "--json")
+                opts.json_path = value;
+            else
+                return false;
+            i += 2;
+        }
+    }
+    catch(std::exception const&)
+    {
+        return false;
+    }
+    if(args.size() != 2)
+        return false;
+    opts.host = args[0];
+    opts.port = args[1];
+    // stod接受inf和nan，nan会被当成闭环；每个连接的发送间隔不能小于一个时钟单位
+    double min_period = std::chrono::duration<double>(load_clock::duration(1)).count();
+    return opts.connections > 0 && opts.threads > 0 && opts.duration > 0 && opts.interval > 0 &&
+        std::isfinite(opts.rate) && opts.rate >= 0 &&
+        (opts.rate == 0 || opts.connections / opts.rate >= min_period);
+}
+
+} // namespace
+
 int main(int argc, char** argv)
 {
+    if(argc >= 2 && std::strcmp(argv[1], "load") == 0)
+    {
+        load_options opts;
+        if(!parse_load_options(argc, argv, opts))
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+
+        // 每条消息的日志会影响测量，只保留警告和错误
+        if(logging::logger::instance().get_level() < logging::level::warn)
+            logging::logger::instance().set_level(logging::level::warn);
+        int rc = load_generator(opts).run();
+        logging::logger::instance().stop();
+        return rc;
+    }
+
+    // 以"--"开头的是压缩选项，其余是按位置的参数
+    compression_options compression;
+    std::vector<char*> args;
+    bool valid = true;
+    for(int i = 1; i < argc && valid;)
+    {
+        if(std::strncmp(argv[i], "--", 2) != 0)
+        {
+            args.push_back(argv[i++]);
+            continue;
+        }
+        int used = parse_compression_arg(argc, argv, i, compression);
+        valid = used > 0;
+        i += used;
+    }
+
     // 检查命令行参数
-    if(argc != 4)
+    if(!valid || args.size() != 3)
     {
-        std::cerr << "用法: websocket_client <主机> <端口> <消息>\n"
-                  << "示例:\n"
-                  << "    websocket_client localhost 8080 \"Hello, WebSocket!\"\n";
+        print_usage();
         return EXIT_FAILURE;
     }
-    
-    auto const host = argv[1];
-    auto const port = argv[2];
-    auto const message = argv[3];
+
+    auto const host = args[0];
+    auto const port = args[1];
+    auto const message = args[2];
 
     // IO上下文
     net::io_context ioc;
 
     // 启动WebSocket会话
-    std::make_shared<session>(ioc)->run(host, port, message);
+    std::make_shared<session>(ioc, compression)->run(host, port, message);
 
     // 运行IO服务
     std::cout << "客户端启动" << std::endl;
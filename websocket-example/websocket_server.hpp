@@ -0,0 +1,906 @@
+//
+// WebSocket服务器实现
+// 会话、广播房间、监听器和运行它们的线程池，供websocket_server和websocket_bench共用
+//
+
+#pragma once
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include "async_logger.hpp"
+#include "compression.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace beast = boost::beast;         // from <boost/beast.hpp>
+namespace http = beast::http;           // from <boost/beast/http.hpp>
+namespace websocket = beast::websocket; // from <boost/beast/websocket.hpp>
+namespace net = boost::asio;            // from <boost/asio.hpp>
+using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+// 线程模型
+enum class io_model
+{
+    shared,     // 一个io_context由所有线程共同运行，会话通过strand串行化
+    reuseport   // 每个线程一个io_context和一个SO_REUSEPORT acceptor，由内核分配连接
+};
+
+// 会话写队列满时的处理方式
+enum class overflow_policy
+{
+    drop_oldest,    // 丢弃队列中最早的一条广播消息
+    disconnect      // 断开跟不上的慢消费者
+};
+
+// 服务器配置
+struct server_options
+{
+    net::ip::address address = net::ip::make_address("0.0.0.0");
+    unsigned short port = 8080;             // 0表示由系统选择端口
+    unsigned threads = 1;
+    io_model model = io_model::shared;
+    bool pin_threads = false;               // reuseport模式下把第i个线程绑定到第i个CPU
+    std::size_t write_queue_limit = 256;    // 每个会话待发送的广播消息上限，至少为4
+    overflow_policy overflow = overflow_policy::drop_oldest;
+    compression_options compression;        // permessage-deflate，默认关闭
+};
+
+// 会话使用具体的strand类型作为执行器
+// 默认的any_io_executor在每次异步操作时都要在堆上复制一份strand，
+// 使用具体类型后稳态的收发路径没有堆分配
+using session_executor = net::strand<net::io_context::executor_type>;
+using session_socket = net::basic_stream_socket<tcp, session_executor>;
+
+// 开启TCP keepalive：空闲150秒后开始探测，每30秒一次，4次无响应即断开
+inline void enable_keepalive(session_socket& socket)
+{
+    beast::error_code ec;
+    socket.set_option(net::socket_base::keep_alive(true), ec);
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+    socket.set_option(net::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPIDLE>(150), ec);
+    socket.set_option(net::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPINTVL>(30), ec);
+    socket.set_option(net::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPCNT>(4), ec);
+#endif
+}
+
+// 会话读缓冲区的池
+// 会话结束时把已经扩容的flat_buffer还给当前线程的池，新会话直接复用，
+// 连接频繁建立和关闭时不需要重新分配和扩容读缓冲区。
+class buffer_pool
+{
+    static constexpr std::size_t max_pooled = 64;               // 每个线程最多保留的缓冲区数
+    static constexpr std::size_t max_capacity = 1024 * 1024;    // 超过该容量的缓冲区直接释放
+
+    static std::vector<beast::flat_buffer>& local()
+    {
+        thread_local std::vector<beast::flat_buffer> pool;
+        return pool;
+    }
+
+public:
+    static beast::flat_buffer acquire()
+    {
+        auto& pool = local();
+        if(pool.empty())
+            return beast::flat_buffer();
+        beast::flat_buffer buffer = std::move(pool.back());
+        pool.pop_back();
+        return buffer;
+    }
+
+    static void release(beast::flat_buffer&& buffer)
+    {
+        auto& pool = local();
+        if(pool.size() >= max_pooled || buffer.capacity() > max_capacity)
+            return;
+        if(pool.capacity() == 0)
+            pool.reserve(max_pooled);
+        buffer.clear();
+        pool.push_back(std::move(buffer));
+    }
+};
+
+// 广播消息
+// 发布时只构造一次，房间里所有订阅者的写队列共享同一份不可变的负载
+struct broadcast_frame
+{
+    std::string payload;
+    bool text = true;
+};
+
+using frame_ptr = std::shared_ptr<broadcast_frame const>;
+
+// 会话的写队列
+// 环形缓冲区，容量按需倍增，达到会话的稳定深度后入队和出队都不再分配内存。
+// 空指针表示回显读缓冲区中的消息，其余元素是共享的广播消息。
+class write_queue
+{
+    std::vector<frame_ptr> slots_;
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+
+public:
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    frame_ptr& operator[](std::size_t i)
+    {
+        return slots_[(head_ + i) % slots_.size()];
+    }
+
+    frame_ptr& front()
+    {
+        return slots_[head_];
+    }
+
+    void push_back(frame_ptr frame)
+    {
+        if(size_ == slots_.size())
+            grow();
+        slots_[(head_ + size_) % slots_.size()] = std::move(frame);
+        ++size_;
+    }
+
+    void pop_front()
+    {
+        slots_[head_].reset();
+        head_ = (head_ + 1) % slots_.size();
+        --size_;
+    }
+
+    // 删除第i个元素，它之前的元素依次后移一位
+    void erase(std::size_t i)
+    {
+        for(; i > 0; --i)
+            (*this)[i] = std::move((*this)[i - 1]);
+        pop_front();
+    }
+
+private:
+    void grow()
+    {
+        std::vector<frame_ptr> slots(std::max<std::size_t>(8, slots_.size() * 2));
+        for(std::size_t i = 0; i < size_; ++i)
+            slots[i] = std::move((*this)[i]);
+        slots_.swap(slots);
+        head_ = 0;
+    }
+};
+
+class session;
+
+// 按名称管理的广播房间
+// 房间保存订阅会话的弱引用，会话销毁时自己退订；
+// 发布只在查找房间时持有注册表的锁，向订阅者投递时只持有该房间的锁。
+class room_registry
+{
+    struct room
+    {
+        std::mutex mutex;
+        std::vector<std::weak_ptr<session>> members;
+        std::vector<session const*> keys;                       // 和members一一对应
+        std::unordered_map<session const*, std::size_t> index;  // 会话在members中的位置
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<room>> rooms_;
+
+public:
+    // 订阅房间，房间不存在时创建；已经订阅过时返回false
+    bool subscribe(std::string_view name, std::shared_ptr<session> const& s);
+
+    // 退订房间，最后一个订阅者离开时删除房间
+    void unsubscribe(std::string_view name, session const* s);
+
+    // 把消息投递到房间内所有会话的写队列，返回订阅者数
+    std::size_t publish(std::string_view name, frame_ptr const& frame);
+
+    std::size_t subscribers(std::string_view name);
+};
+
+// 所有会话共享的服务器状态
+struct server_state
+{
+    std::size_t write_queue_limit;
+    overflow_policy overflow;
+    compression_options compression;
+    room_registry rooms;
+    std::atomic<std::uint64_t> dropped_frames{0};     // drop_oldest策略丢弃的广播消息数
+    std::atomic<std::uint64_t> slow_disconnects{0};   // disconnect策略断开的连接数
+
+    explicit server_state(server_options const& options)
+        : write_queue_limit(std::max<std::size_t>(options.write_queue_limit, 4))
+        , overflow(options.overflow)
+        , compression(options.compression)
+    {
+    }
+};
+
+// 处理单个WebSocket连接的会话
+// 普通消息回显给发送者；以"/"开头的命令订阅、退订房间或向房间广播：
+//   /sub <房间>
+//   /unsub <房间>
+//   /pub <房间> <消息>
+class session : public std::enable_shared_from_this<session>
+{
+    websocket::stream<session_socket> ws_;
+    beast::flat_buffer buffer_;
+    std::shared_ptr<server_state> state_;
+    write_queue queue_;
+    std::vector<std::string> rooms_;    // 已订阅的房间，会话销毁时退订
+    bool writing_ = false;
+    bool echo_text_ = true;
+    bool corked_ = false;
+    bool closing_ = false;
+
+    // 回显消息的前缀，和收到的消息一起作为分散/聚集缓冲区发送
+    static constexpr char echo_prefix[] = "服务器回显: ";
+
+public:
+    // 接受TCP套接字的构造函数
+    session(session_socket socket, std::shared_ptr<server_state> state)
+        : ws_(std::move(socket))
+        , buffer_(buffer_pool::acquire())
+        , state_(std::move(state))
+    {
+        WS_LOG_DEBUG("创建新会话");
+    }
+
+    ~session()
+    {
+        for(auto const& name : rooms_)
+            state_->rooms.unsubscribe(name, this);
+        buffer_pool::release(std::move(buffer_));
+    }
+
+    // 开始会话
+    void run()
+    {
+        // 设置一个断点在这里可以查看新连接
+        WS_LOG_DEBUG("会话开始运行");
+
+        // 设置WebSocket选项
+        // Beast的空闲超时在每次读操作开始时重新启动定时器，定时器的any_io_executor
+        // 每次都要在堆上复制会话的strand；这里关闭空闲超时，改用TCP keepalive检测失效的连接
+        auto timeout = websocket::stream_base::timeout::suggested(beast::role_type::server);
+        timeout.idle_timeout = websocket::stream_base::none();
+        ws_.set_option(timeout);
+        enable_keepalive(ws_.next_layer());
+
+        // 客户端也提供permessage-deflate时在握手中协商压缩
+        ws_.set_option(make_permessage_deflate(state_->compression, beast::role_type::server));
+
+        // 设置最大消息大小限制
+        ws_.set_option(websocket::stream_base::decorator(
+            [](websocket::response_type& res)
+            {
+                res.set(http::field::server,
+                    std::string(BOOST_BEAST_VERSION_STRING) +
+                        " websocket-server-example");
+            }));
+
+        // 接受WebSocket握手
+        ws_.async_accept(
+            beast::bind_front_handler(
+                &session::on_accept,
+                shared_from_this()));
+    }
+
+    // 把广播消息放入写队列，可以在任意线程调用
+    void deliver(frame_ptr frame)
+    {
+        net::post(
+            ws_.get_executor(),
+            beast::bind_front_handler(
+                &session::enqueue,
+                shared_from_this(),
+                std::move(frame)));
+    }
+
+private:
+    void on_accept(beast::error_code ec)
+    {
+        if(ec)
+        {
+            WS_LOG_ERROR("接受失败: {}", ec.message());
+            return;
+        }
+
+        // 设置一个断点在这里可以查看握手完成
+        WS_LOG_INFO("WebSocket握手成功");
+
+        // 读取消息
+        do_read();
+    }
+
+    void do_read()
+    {
+        // 读取消息
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &session::on_read,
+                shared_from_this()));
+    }
+
+    void on_read(
+        beast::error_code ec,
+        std::size_t bytes_transferred)
+    {
+        boost::ignore_unused(bytes_transferred);
+
+        // 处理可能的错误
+        if(ec == websocket::error::closed)
+        {
+            WS_LOG_INFO("连接已关闭");
+            return;
+        }
+
+        if(ec)
+        {
+            if(!closing_)
+                WS_LOG_ERROR("读取失败: {}", ec.message());
+            return;
+        }
+
+        // 设置一个断点在这里可以查看接收到的消息
+        std::string_view message(
+            static_cast<char const*>(buffer_.data().data()), buffer_.size());
+        WS_LOG_DEBUG("收到消息: {}", message);
+
+        if(!message.empty() && message.front() == '/' && handle_command(message))
+        {
+            buffer_.consume(buffer_.size());
+            do_read();
+            return;
+        }
+
+        // 回显直接引用读缓冲区中的消息，缓冲区在回显写完之前必须保持有效，
+        // 所以写完之后才清除缓冲区并读取下一条消息
+        echo_text_ = ws_.got_text();
+        enqueue(nullptr);
+    }
+
+    // 处理房间命令，无法识别的命令按普通消息回显
+    bool handle_command(std::string_view message)
+    {
+        auto space = message.find(' ');
+        std::string_view command = message.substr(0, space);
+        std::string_view rest = space == std::string_view::npos
+            ? std::string_view() : message.substr(space + 1);
+
+        if(command == "/pub")
+        {
+            space = rest.find(' ');
+            std::string_view name = rest.substr(0, space);
+            std::string_view payload = space == std::string_view::npos
+                ? std::string_view() : rest.substr(space + 1);
+            if(name.empty())
+                return false;
+
+            // 负载只复制这一次，之后所有订阅者共享同一个frame
+            auto frame = std::make_shared<broadcast_frame const>(
+                broadcast_frame{std::string(payload), ws_.got_text()});
+            std::size_t count = state_->rooms.publish(name, frame);
+            WS_LOG_DEBUG("广播到房间 {}: {} 个订阅者", name, count);
+            return true;
+        }
+
+        if(command == "/sub" && !rest.empty())
+        {
+            if(state_->rooms.subscribe(rest, shared_from_this()))
+                rooms_.emplace_back(rest);
+            reply("已订阅: ", rest);
+            return true;
+        }
+
+        if(command == "/unsub" && !rest.empty())
+        {
+            auto it = std::find(rooms_.begin(), rooms_.end(), rest);
+            if(it != rooms_.end())
+            {
+                state_->rooms.unsubscribe(rest, this);
+                rooms_.erase(it);
+            }
+            reply("已退订: ", rest);
+            return true;
+        }
+
+        return false;
+    }
+
+    // 命令的确认消息和广播消息一样进入写队列
+    void reply(std::string_view prefix, std::string_view name)
+    {
+        std::string text;
+        text.reserve(prefix.size() + name.size());
+        text.append(prefix).append(name);
+        enqueue(std::make_shared<broadcast_frame const>(broadcast_frame{std::move(text), true}));
+    }
+
+    // 在会话的strand上执行
+    void enqueue(frame_ptr frame)
+    {
+        if(closing_)
+            return;
+
+        // 回显不受队列上限限制：回显写完之前不会读取下一条消息，队列中最多只有一个回显
+        if(frame && queue_.size() >= state_->write_queue_limit)
+        {
+            if(state_->overflow == overflow_policy::disconnect)
+            {
+                state_->slow_disconnects.fetch_add(1, std::memory_order_relaxed);
+                WS_LOG_WARN("写队列已满，断开慢消费者");
+                closing_ = true;
+                beast::error_code ec;
+                beast::get_lowest_layer(ws_).close(ec);
+                return;
+            }
+
+            // 丢弃最早的一条广播消息，正在写的队首和回显都不能丢
+            for(std::size_t i = writing_ ? 1 : 0; i < queue_.size(); ++i)
+            {
+                if(queue_[i])
+                {
+                    queue_.erase(i);
+                    state_->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+
+        queue_.push_back(std::move(frame));
+        if(!writing_)
+            do_write();
+        else if(!corked_)
+            set_cork(true);
+    }
+
+    // 有消息积压时打开TCP_CORK，积压的小消息由内核合并成完整的报文段发送，
+    // 队列清空时关闭TCP_CORK，剩余的数据立即发出
+    void set_cork(bool on)
+    {
+#ifdef TCP_CORK
+        beast::error_code ec;
+        using cork_option = net::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK>;
+        beast::get_lowest_layer(ws_).set_option(cork_option(on), ec);
+#endif
+        corked_ = on;
+    }
+
+    void do_write()
+    {
+        writing_ = true;
+        frame_ptr const& frame = queue_.front();
+        if(frame)
+        {
+            ws_.text(frame->text);
+            ws_.async_write(
+                net::buffer(frame->payload),
+                beast::bind_front_handler(
+                    &session::on_write,
+                    shared_from_this()));
+            return;
+        }
+
+        // 前缀和读缓冲区中的消息直接组成一帧发送，不复制消息
+        std::array<net::const_buffer, 2> echo{{
+            net::buffer(echo_prefix, sizeof(echo_prefix) - 1),
+            buffer_.data()}};
+        ws_.text(echo_text_);
+        ws_.async_write(
+            echo,
+            beast::bind_front_handler(
+                &session::on_write,
+                shared_from_this()));
+    }
+
+    void on_write(
+        beast::error_code ec,
+        std::size_t bytes_transferred)
+    {
+        boost::ignore_unused(bytes_transferred);
+
+        writing_ = false;
+        bool echoed = !queue_.front();
+        queue_.pop_front();
+
+        if(ec)
+        {
+            if(!closing_)
+                WS_LOG_ERROR("写入失败: {}", ec.message());
+            closing_ = true;
+            return;
+        }
+
+        // 设置一个断点在这里可以查看消息发送完成
+        WS_LOG_DEBUG("消息已发送");
+
+        if(echoed)
+        {
+            // 清除已经回显的消息，继续读取下一条消息
+            buffer_.consume(buffer_.size());
+            do_read();
+        }
+
+        if(!queue_.empty())
+            do_write();
+        else if(corked_)
+            set_cork(false);
+    }
+};
+
+inline bool room_registry::subscribe(std::string_view name, std::shared_ptr<session> const& s)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& r = rooms_[std::string(name)];
+    if(!r)
+        r = std::make_shared<room>();
+    std::lock_guard<std::mutex> room_lock(r->mutex);
+    if(!r->index.emplace(s.get(), r->members.size()).second)
+        return false;
+    r->members.push_back(s);
+    r->keys.push_back(s.get());
+    return true;
+}
+
+inline void room_registry::unsubscribe(std::string_view name, session const* s)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(std::string(name));
+    if(it == rooms_.end())
+        return;
+    room& r = *it->second;
+    std::lock_guard<std::mutex> room_lock(r.mutex);
+    auto pos = r.index.find(s);
+    if(pos == r.index.end())
+        return;
+
+    // 用最后一个订阅者填补空位，退订是O(1)的
+    std::size_t i = pos->second;
+    r.index.erase(pos);
+    if(i + 1 != r.members.size())
+    {
+        r.members[i] = std::move(r.members.back());
+        r.keys[i] = r.keys.back();
+        r.index[r.keys[i]] = i;
+    }
+    r.members.pop_back();
+    r.keys.pop_back();
+    if(r.members.empty())
+        rooms_.erase(it);
+}
+
+inline std::size_t room_registry::publish(std::string_view name, frame_ptr const& frame)
+{
+    std::shared_ptr<room> r;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = rooms_.find(std::string(name));
+        if(it == rooms_.end())
+            return 0;
+        r = it->second;
+    }
+
+    // 在房间锁内只取出存活的会话，投递和释放引用都在解锁之后进行：
+    // 其他线程上的会话可能同时结束，这里的引用可能是最后一个，
+    // 析构时的退订需要同一把房间锁
+    std::vector<std::shared_ptr<session>> targets;
+    {
+        std::lock_guard<std::mutex> room_lock(r->mutex);
+        targets.reserve(r->members.size());
+        for(auto const& member : r->members)
+        {
+            // 正在析构的会话还没有退订时lock()返回空
+            if(auto s = member.lock())
+                targets.push_back(std::move(s));
+        }
+    }
+
+    for(auto const& s : targets)
+        s->deliver(frame);
+    return targets.size();
+}
+
+inline std::size_t room_registry::subscribers(std::string_view name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rooms_.find(std::string(name));
+    if(it == rooms_.end())
+        return 0;
+    std::lock_guard<std::mutex> room_lock(it->second->mutex);
+    return it->second->members.size();
+}
+
+// 接受传入连接并启动会话的监听器
+class listener : public std::enable_shared_from_this<listener>
+{
+    net::io_context& ioc_;
+    tcp::acceptor acceptor_;
+    std::shared_ptr<server_state> state_;
+    bool ok_ = false;
+
+public:
+    listener(
+        net::io_context& ioc,
+        tcp::endpoint endpoint,
+        bool reuse_port,
+        std::shared_ptr<server_state> state)
+        : ioc_(ioc)
+        , acceptor_(ioc)
+        , state_(std::move(state))
+    {
+        beast::error_code ec;
+
+        // 打开acceptor
+        acceptor_.open(endpoint.protocol(), ec);
+        if(ec)
+        {
+            WS_LOG_ERROR("打开失败: {}", ec.message());
+            return;
+        }
+
+        // 允许地址重用
+        acceptor_.set_option(net::socket_base::reuse_address(true), ec);
+        if(ec)
+        {
+            WS_LOG_ERROR("设置选项失败: {}", ec.message());
+            return;
+        }
+
+#ifdef SO_REUSEPORT
+        // 多个acceptor绑定同一端口，由内核按连接的四元组哈希分配
+        if(reuse_port)
+        {
+            using reuse_port_option = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+            acceptor_.set_option(reuse_port_option(true), ec);
+            if(ec)
+            {
+                WS_LOG_ERROR("设置SO_REUSEPORT失败: {}", ec.message());
+                return;
+            }
+        }
+#else
+        if(reuse_port)
+        {
+            WS_LOG_ERROR("此平台不支持SO_REUSEPORT");
+            return;
+        }
+#endif
+
+        // 绑定到端点
+        acceptor_.bind(endpoint, ec);
+        if(ec)
+        {
+            WS_LOG_ERROR("绑定失败: {}", ec.message());
+            return;
+        }
+
+        // 开始监听连接
+        acceptor_.listen(
+            net::socket_base::max_listen_connections, ec);
+        if(ec)
+        {
+            WS_LOG_ERROR("监听失败: {}", ec.message());
+            return;
+        }
+        ok_ = true;
+    }
+
+    // 构造时打开、绑定和监听是否都成功
+    bool ok() const
+    {
+        return ok_;
+    }
+
+    // 实际监听的端口，端点的端口为0时由系统选择
+    unsigned short port() const
+    {
+        beast::error_code ec;
+        return acceptor_.local_endpoint(ec).port();
+    }
+
+    // 开始接受传入连接
+    void run()
+    {
+        // 设置一个断点在这里可以查看服务器启动
+        WS_LOG_INFO("服务器开始监听连接");
+
+        do_accept();
+    }
+
+    void stop()
+    {
+        beast::error_code ec;
+        acceptor_.close(ec);
+    }
+
+private:
+    void do_accept()
+    {
+        // 异步接受连接
+        acceptor_.async_accept(
+            net::make_strand(ioc_),
+            beast::bind_front_handler(
+                &listener::on_accept,
+                shared_from_this()));
+    }
+
+    void on_accept(beast::error_code ec, session_socket socket)
+    {
+        if(ec == net::error::operation_aborted)
+            return;
+
+        if(ec)
+        {
+            WS_LOG_ERROR("接受失败: {}", ec.message());
+        }
+        else
+        {
+            // 设置一个断点在这里可以查看新连接
+            WS_LOG_INFO("接受新连接");
+
+            // 创建会话并运行它
+            std::make_shared<session>(std::move(socket), state_)->run();
+        }
+
+        // 接受下一个连接
+        do_accept();
+    }
+};
+
+// 运行监听器和会话的线程池
+// shared模式：一个io_context，threads个线程同时调用run()；
+// reuseport模式：threads个io_context，每个只由一个线程运行，各自拥有一个SO_REUSEPORT acceptor，
+// 连接的所有处理都留在接受它的线程上，不需要跨线程同步。
+class server
+{
+    server_options options_;
+    std::shared_ptr<server_state> state_;
+    std::vector<std::unique_ptr<net::io_context>> contexts_;
+    std::vector<std::shared_ptr<listener>> listeners_;
+    std::vector<std::thread> threads_;
+    unsigned short port_ = 0;
+
+public:
+    explicit server(server_options options)
+        : options_(std::move(options))
+        , state_(std::make_shared<server_state>(options_))
+    {
+        if(options_.threads == 0)
+            options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ~server()
+    {
+        stop();
+        join();
+    }
+
+    server(server const&) = delete;
+    server& operator=(server const&) = delete;
+
+    // 创建监听器并启动线程，失败时返回false
+    bool start()
+    {
+        bool reuse_port = options_.model == io_model::reuseport;
+        unsigned context_count = reuse_port ? options_.threads : 1;
+        tcp::endpoint endpoint{options_.address, options_.port};
+
+        for(unsigned i = 0; i < context_count; ++i)
+        {
+            // 只有一个线程运行的io_context可以省掉内部的锁
+            int hint = reuse_port ? 1 : static_cast<int>(options_.threads);
+            contexts_.push_back(std::make_unique<net::io_context>(hint));
+            auto l = std::make_shared<listener>(*contexts_.back(), endpoint, reuse_port, state_);
+            if(!l->ok())
+            {
+                listeners_.clear();
+                contexts_.clear();
+                return false;
+            }
+            // 端口为0时其余acceptor绑定到第一个acceptor得到的端口
+            endpoint.port(l->port());
+            listeners_.push_back(l);
+        }
+        port_ = endpoint.port();
+
+        for(auto& l : listeners_)
+            l->run();
+
+        for(unsigned i = 0; i < options_.threads; ++i)
+        {
+            net::io_context& ioc = *contexts_[reuse_port ? i : 0];
+            threads_.emplace_back([this, &ioc, i]
+            {
+                if(options_.pin_threads)
+                    pin_to_cpu(i);
+                ioc.run();
+            });
+        }
+        return true;
+    }
+
+    // 停止接受连接并让所有线程退出
+    void stop()
+    {
+        for(auto& ctx : contexts_)
+            ctx->stop();
+    }
+
+    // 等待所有线程退出
+    void join()
+    {
+        for(auto& t : threads_)
+        {
+            if(t.joinable())
+                t.join();
+        }
+        threads_.clear();
+    }
+
+    unsigned short port() const
+    {
+        return port_;
+    }
+
+    unsigned threads() const
+    {
+        return options_.threads;
+    }
+
+    // 广播房间和写队列的统计
+    server_state& state()
+    {
+        return *state_;
+    }
+
+    // 第一个io_context，可以用来挂接信号处理等额外的工作
+    net::io_context& context()
+    {
+        return *contexts_.front();
+    }
+
+private:
+    static void pin_to_cpu(unsigned index)
+    {
+#ifdef __linux__
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if(rc != 0)
+            WS_LOG_ERROR("绑定CPU失败: {}", std::strerror(rc));
+#else
+        boost::ignore_unused(index);
+#endif
+    }
+};